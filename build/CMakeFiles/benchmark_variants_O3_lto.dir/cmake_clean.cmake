@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark_variants_O3_lto.dir/tests/benchmark_tests.c.o"
+  "CMakeFiles/benchmark_variants_O3_lto.dir/tests/benchmark_tests.c.o.d"
+  "benchmark_variants_O3_lto"
+  "benchmark_variants_O3_lto.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/benchmark_variants_O3_lto.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark_variants_O3_native.dir/tests/benchmark_tests.c.o"
+  "CMakeFiles/benchmark_variants_O3_native.dir/tests/benchmark_tests.c.o.d"
+  "benchmark_variants_O3_native"
+  "benchmark_variants_O3_native.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/benchmark_variants_O3_native.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,42 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tests/benchmark_tests.c" "CMakeFiles/failing_tests.dir/tests/benchmark_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/benchmark_tests.c.o.d"
+  "/root/repo/tests/cached_data_tests.c" "CMakeFiles/failing_tests.dir/tests/cached_data_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/cached_data_tests.c.o.d"
+  "/root/repo/tests/char_tests.c" "CMakeFiles/failing_tests.dir/tests/char_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/char_tests.c.o.d"
+  "/root/repo/tests/data_tests.c" "CMakeFiles/failing_tests.dir/tests/data_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/data_tests.c.o.d"
+  "/root/repo/tests/dependency_tests.c" "CMakeFiles/failing_tests.dir/tests/dependency_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/dependency_tests.c.o.d"
+  "/root/repo/tests/disabled_tests.c" "CMakeFiles/failing_tests.dir/tests/disabled_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/disabled_tests.c.o.d"
+  "/root/repo/tests/fixture_tests.c" "CMakeFiles/failing_tests.dir/tests/fixture_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/fixture_tests.c.o.d"
+  "/root/repo/tests/float_tests.c" "CMakeFiles/failing_tests.dir/tests/float_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/float_tests.c.o.d"
+  "/root/repo/tests/indexed_tests.c" "CMakeFiles/failing_tests.dir/tests/indexed_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/indexed_tests.c.o.d"
+  "/root/repo/tests/integer_tests.c" "CMakeFiles/failing_tests.dir/tests/integer_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/integer_tests.c.o.d"
+  "/root/repo/tests/isa_tests.c" "CMakeFiles/failing_tests.dir/tests/isa_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/isa_tests.c.o.d"
+  "/root/repo/tests/leak_tests.c" "CMakeFiles/failing_tests.dir/tests/leak_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/leak_tests.c.o.d"
+  "/root/repo/tests/oom_tests.c" "CMakeFiles/failing_tests.dir/tests/oom_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/oom_tests.c.o.d"
+  "/root/repo/tests/registration_tests.c" "CMakeFiles/failing_tests.dir/tests/registration_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/registration_tests.c.o.d"
+  "/root/repo/tests/shared_setup_tests.c" "CMakeFiles/failing_tests.dir/tests/shared_setup_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/shared_setup_tests.c.o.d"
+  "/root/repo/tests/skip_tests.c" "CMakeFiles/failing_tests.dir/tests/skip_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/skip_tests.c.o.d"
+  "/root/repo/tests/statistical_tests.c" "CMakeFiles/failing_tests.dir/tests/statistical_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/statistical_tests.c.o.d"
+  "/root/repo/tests/string_tests.c" "CMakeFiles/failing_tests.dir/tests/string_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/string_tests.c.o.d"
+  "/root/repo/tests/subtest_tests.c" "CMakeFiles/failing_tests.dir/tests/subtest_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/subtest_tests.c.o.d"
+  "/root/repo/tests/suite_fixture_tests.c" "CMakeFiles/failing_tests.dir/tests/suite_fixture_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/suite_fixture_tests.c.o.d"
+  "/root/repo/tests/sweep_tests.c" "CMakeFiles/failing_tests.dir/tests/sweep_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/sweep_tests.c.o.d"
+  "/root/repo/tests/typed_tests.c" "CMakeFiles/failing_tests.dir/tests/typed_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/typed_tests.c.o.d"
+  "/root/repo/tests/wildcard_match_tests.c" "CMakeFiles/failing_tests.dir/tests/wildcard_match_tests.c.o" "gcc" "CMakeFiles/failing_tests.dir/tests/wildcard_match_tests.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/build/CMakeFiles/rktest.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/rktest.dir/src/rktest.c.o"
+  "CMakeFiles/rktest.dir/src/rktest.c.o.d"
+  "librktest.a"
+  "librktest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/rktest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
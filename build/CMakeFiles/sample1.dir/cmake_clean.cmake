@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sample1.dir/samples/sample01_factorial.c.o"
+  "CMakeFiles/sample1.dir/samples/sample01_factorial.c.o.d"
+  "sample1"
+  "sample1.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/sample1.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
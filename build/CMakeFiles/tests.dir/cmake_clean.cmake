@@ -0,0 +1,55 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tests.dir/tests/benchmark_tests.c.o"
+  "CMakeFiles/tests.dir/tests/benchmark_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/cached_data_tests.c.o"
+  "CMakeFiles/tests.dir/tests/cached_data_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/char_tests.c.o"
+  "CMakeFiles/tests.dir/tests/char_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/data_tests.c.o"
+  "CMakeFiles/tests.dir/tests/data_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/dependency_tests.c.o"
+  "CMakeFiles/tests.dir/tests/dependency_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/disabled_tests.c.o"
+  "CMakeFiles/tests.dir/tests/disabled_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/fixture_tests.c.o"
+  "CMakeFiles/tests.dir/tests/fixture_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/float_tests.c.o"
+  "CMakeFiles/tests.dir/tests/float_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/indexed_tests.c.o"
+  "CMakeFiles/tests.dir/tests/indexed_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/integer_tests.c.o"
+  "CMakeFiles/tests.dir/tests/integer_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/isa_tests.c.o"
+  "CMakeFiles/tests.dir/tests/isa_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/leak_tests.c.o"
+  "CMakeFiles/tests.dir/tests/leak_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/oom_tests.c.o"
+  "CMakeFiles/tests.dir/tests/oom_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/registration_tests.c.o"
+  "CMakeFiles/tests.dir/tests/registration_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/shared_setup_tests.c.o"
+  "CMakeFiles/tests.dir/tests/shared_setup_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/skip_tests.c.o"
+  "CMakeFiles/tests.dir/tests/skip_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/statistical_tests.c.o"
+  "CMakeFiles/tests.dir/tests/statistical_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/string_tests.c.o"
+  "CMakeFiles/tests.dir/tests/string_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/subtest_tests.c.o"
+  "CMakeFiles/tests.dir/tests/subtest_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/suite_fixture_tests.c.o"
+  "CMakeFiles/tests.dir/tests/suite_fixture_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/sweep_tests.c.o"
+  "CMakeFiles/tests.dir/tests/sweep_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/typed_tests.c.o"
+  "CMakeFiles/tests.dir/tests/typed_tests.c.o.d"
+  "CMakeFiles/tests.dir/tests/wildcard_match_tests.c.o"
+  "CMakeFiles/tests.dir/tests/wildcard_match_tests.c.o.d"
+  "tests"
+  "tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,105 @@
+# rktest_add_benchmark_variants(<name>
+#     SOURCES <source>...
+#     VARIANTS <variant>...
+#     [LIBRARIES <library>...]
+#     [ARGS <arg>...])
+#
+# Builds the benchmark sources once per variant, as executables named
+# <name>_<variant>, and adds a target <name> that runs all of them and prints
+# the median time of every benchmark side by side, relative to the first
+# variant. A variant is one or more of these options joined with '+', e.g.
+# O3+native+lto:
+#
+#   O0, O1, O2, O3, Os  Optimization level
+#   native              Optimize for the building machine (-march=native)
+#   lto                 Link time optimization
+#
+# ARGS are passed to every run, and default to --rktest_benchmark=*. The JSON
+# results are kept next to the executables as <name>_<variant>.json. Comparing
+# them needs CMake 3.19 for string(JSON), so with older versions no targets are
+# added and a warning is printed.
+#
+# MSVC rejects optimization together with the runtime checks (/RTC1) of Debug
+# builds, and flags of a configuration can not be removed per target, so with
+# MSVC the optimization levels only apply outside of Debug builds.
+
+include(CheckIPOSupported)
+
+set(RKTEST_COMPARE_BENCHMARKS_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/RKTestCompareBenchmarks.cmake" CACHE INTERNAL "")
+
+function(rktest_add_benchmark_variants name)
+    cmake_parse_arguments(PARSE_ARGV 1 arg "" "" "SOURCES;VARIANTS;LIBRARIES;ARGS")
+    if(NOT arg_SOURCES OR NOT arg_VARIANTS)
+        message(FATAL_ERROR "rktest_add_benchmark_variants(${name}) needs SOURCES and VARIANTS")
+    endif()
+    if(CMAKE_VERSION VERSION_LESS 3.19)
+        message(WARNING "rktest_add_benchmark_variants(${name}) needs CMake 3.19 or newer to compare the results, not adding ${name}")
+        return()
+    endif()
+    if(NOT arg_ARGS)
+        set(arg_ARGS "--rktest_benchmark=*")
+    endif()
+
+    # Lists are passed to the script joined with '|', as ';' would split them
+    set(variant_names "")
+    set(executables "")
+    foreach(variant IN LISTS arg_VARIANTS)
+        string(REPLACE "+" "_" suffix "${variant}")
+        set(variant_target "${name}_${suffix}")
+        add_executable(${variant_target} ${arg_SOURCES})
+        target_link_libraries(${variant_target} PRIVATE rktest ${arg_LIBRARIES})
+
+        string(REPLACE "+" ";" options "${variant}")
+        foreach(option IN LISTS options)
+            if(option MATCHES "^O([0-3s])$")
+                if(MSVC)
+                    set(msvc_flags_0 /Od)
+                    set(msvc_flags_1 /O1)
+                    set(msvc_flags_2 /O2)
+                    set(msvc_flags_3 /Ox)
+                    set(msvc_flags_s /O1)
+                    target_compile_options(${variant_target} PRIVATE $<$<NOT:$<CONFIG:Debug>>:${msvc_flags_${CMAKE_MATCH_1}}>)
+                else()
+                    target_compile_options(${variant_target} PRIVATE -${option})
+                endif()
+            elseif(option STREQUAL "native")
+                if(MSVC)
+                    message(WARNING "Benchmark variant ${variant}: MSVC has no equivalent of -march=native")
+                else()
+                    target_compile_options(${variant_target} PRIVATE -march=native)
+                endif()
+            elseif(option STREQUAL "lto")
+                check_ipo_supported(RESULT is_lto_supported OUTPUT lto_error LANGUAGES C)
+                if(NOT is_lto_supported)
+                    message(WARNING "Benchmark variant ${variant}: link time optimization is not supported: ${lto_error}")
+                endif()
+                set_property(TARGET ${variant_target} PROPERTY INTERPROCEDURAL_OPTIMIZATION ${is_lto_supported})
+            else()
+                message(FATAL_ERROR "Benchmark variant ${variant}: unknown option ${option}, expected O0, O1, O2, O3, Os, native or lto")
+            endif()
+        endforeach()
+
+        string(APPEND variant_names "|${variant}")
+        string(APPEND executables "|$<TARGET_FILE:${variant_target}>")
+        list(APPEND variant_targets ${variant_target})
+    endforeach()
+    string(SUBSTRING "${variant_names}" 1 -1 variant_names)
+    string(SUBSTRING "${executables}" 1 -1 executables)
+    string(REPLACE ";" "|" args "${arg_ARGS}")
+
+    if(MSVC AND CMAKE_BUILD_TYPE STREQUAL "Debug")
+        message(WARNING "rktest_add_benchmark_variants(${name}): MSVC Debug builds can not be optimized, build another configuration to compare optimization levels")
+    endif()
+
+    add_custom_target(${name}
+        COMMAND ${CMAKE_COMMAND}
+            "-DVARIANTS=${variant_names}"
+            "-DEXECUTABLES=${executables}"
+            "-DARGS=${args}"
+            "-DJSON_PREFIX=${CMAKE_CURRENT_BINARY_DIR}/${name}_"
+            -P "${RKTEST_COMPARE_BENCHMARKS_SCRIPT}"
+        DEPENDS ${variant_targets}
+        USES_TERMINAL
+        VERBATIM
+    )
+endfunction()
@@ -0,0 +1,144 @@
+# Runs the executables of rktest_add_benchmark_variants() and prints the median
+# time of every benchmark per variant. Without EXECUTABLES, only compares the
+# JSON files of a previous run.
+#
+#   cmake -DVARIANTS=O2|O3 [-DEXECUTABLES=a|b] [-DARGS=...] -DJSON_PREFIX=dir/name_ -P RKTestCompareBenchmarks.cmake
+cmake_minimum_required(VERSION 3.19) # string(JSON)
+
+string(REPLACE "|" ";" variants "${VARIANTS}")
+string(REPLACE "|" ";" executables "${EXECUTABLES}")
+string(REPLACE "|" ";" args "${ARGS}")
+
+# Formats nanoseconds like the benchmark output, e.g. 84.0 ns or 1.25 us
+function(format_nanos out ns)
+    if(ns LESS 1000)
+        set(${out} "${ns}.0 ns" PARENT_SCOPE)
+        return()
+    endif()
+    set(unit_ns 1000)
+    set(unit "us")
+    if(ns GREATER_EQUAL 1000000000)
+        set(unit_ns 1000000000)
+        set(unit "s")
+    elseif(ns GREATER_EQUAL 1000000)
+        set(unit_ns 1000000)
+        set(unit "ms")
+    endif()
+    math(EXPR hundredths "(${ns} * 100 + ${unit_ns} / 2) / ${unit_ns}")
+    math(EXPR whole "${hundredths} / 100")
+    math(EXPR fraction "${hundredths} % 100")
+    if(fraction LESS 10)
+        set(fraction "0${fraction}")
+    endif()
+    set(${out} "${whole}.${fraction} ${unit}" PARENT_SCOPE)
+endfunction()
+
+# Formats the change from `base_ns` to `ns` in percent, e.g. -4.8%
+function(format_change out base_ns ns)
+    if(base_ns EQUAL 0)
+        set(${out} "" PARENT_SCOPE)
+        return()
+    endif()
+    set(sign "+")
+    math(EXPR difference "${ns} - ${base_ns}")
+    if(difference LESS 0)
+        set(sign "-")
+        math(EXPR difference "-${difference}")
+    endif()
+    math(EXPR tenths "(${difference} * 2000 / ${base_ns} + 1) / 2")
+    math(EXPR whole "${tenths} / 10")
+    math(EXPR fraction "${tenths} % 10")
+    set(${out} "${sign}${whole}.${fraction}%" PARENT_SCOPE)
+endfunction()
+
+function(pad out text width)
+    string(LENGTH "${text}" length)
+    if(length LESS width)
+        math(EXPR padding "${width} - ${length}")
+        string(REPEAT " " ${padding} spaces)
+        string(APPEND text "${spaces}")
+    endif()
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+# Run every variant
+set(index 0)
+foreach(executable IN LISTS executables)
+    list(GET variants ${index} variant)
+    message(STATUS "Running benchmark variant ${variant}")
+    execute_process(
+        COMMAND "${executable}" ${args} "--rktest_benchmark_json=${JSON_PREFIX}${variant}.json"
+        RESULT_VARIABLE result
+    )
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Benchmark variant ${variant} failed: ${result}")
+    endif()
+    math(EXPR index "${index} + 1")
+endforeach()
+
+# Collect the median time per benchmark and variant. The order benchmarks are
+# registered in differs between optimization levels, so rows are sorted by name
+set(benchmark_names "")
+set(name_width 9)
+foreach(variant IN LISTS variants)
+    set(json_path "${JSON_PREFIX}${variant}.json")
+    if(NOT EXISTS "${json_path}")
+        message(FATAL_ERROR "No benchmark results of variant ${variant} in ${json_path}")
+    endif()
+    file(READ "${json_path}" json)
+    string(JSON num_benchmarks LENGTH "${json}" benchmarks)
+    if(num_benchmarks EQUAL 0)
+        continue()
+    endif()
+    math(EXPR last "${num_benchmarks} - 1")
+    foreach(i RANGE ${last})
+        string(JSON name GET "${json}" benchmarks ${i} name)
+        string(JSON p50_ns GET "${json}" benchmarks ${i} p50_ns)
+        list(FIND benchmark_names "${name}" key)
+        if(key EQUAL -1)
+            list(LENGTH benchmark_names key)
+            list(APPEND benchmark_names "${name}")
+            string(LENGTH "${name}" length)
+            if(length GREATER name_width)
+                set(name_width ${length})
+            endif()
+        endif()
+        set("p50_${key}_${variant}" ${p50_ns})
+    endforeach()
+endforeach()
+
+# Print the table, with changes relative to the first variant
+set(sorted_benchmark_names ${benchmark_names})
+list(SORT sorted_benchmark_names)
+math(EXPR name_width "${name_width} + 2")
+set(column_width 22)
+pad(line "Benchmark" ${name_width})
+foreach(variant IN LISTS variants)
+    pad(cell "${variant}" ${column_width})
+    string(APPEND line "${cell}")
+endforeach()
+string(STRIP "${line}" line)
+set(table "Median time per benchmark variant\n\n${line}\n")
+list(GET variants 0 base_variant)
+foreach(name IN LISTS sorted_benchmark_names)
+    list(FIND benchmark_names "${name}" key)
+    pad(line "${name}" ${name_width})
+    foreach(variant IN LISTS variants)
+        set(cell "-")
+        if(DEFINED "p50_${key}_${variant}")
+            set(ns "${p50_${key}_${variant}}")
+            format_nanos(cell ${ns})
+            if(NOT variant STREQUAL base_variant AND DEFINED "p50_${key}_${base_variant}")
+                format_change(change "${p50_${key}_${base_variant}}" ${ns})
+                if(change)
+                    string(APPEND cell " (${change})")
+                endif()
+            endif()
+        endif()
+        pad(cell "${cell}" ${column_width})
+        string(APPEND line "${cell}")
+    endforeach()
+    string(STRIP "${line}" line)
+    string(APPEND table "${line}\n")
+endforeach()
+message("${table}")
@@ -20,6 +20,9 @@
 //    RK Test dependens on the standard math library.
 //    Link to it by passing `-lm` to the compiler.
 //
+//    Except on Windows, RK Test also depends on POSIX threads.
+//    Link to them by passing `-pthread` to the compiler.
+//
 // USAGE
 //
 //   Include this file in whatever places need to refer to it. In EXACLTY ONE
@@ -122,6 +125,437 @@
 //   NOTE: See https://randomascii.wordpress.com/2012/02/25/comparing-floating-point-numbers-2012-edition/
 //   for more information about units in the last place.
 //
+//   Exhaustive sweeps:
+//   | Macro name                                  | Assertion                                        |
+//   | ------------------------------------------- | ------------------------------------------------ |
+//   | EXPECT_FOR_ALL_UINT16(check, user_data)     | `check` passes for all 2^16 `uint16_t` values    |
+//   | EXPECT_FOR_ALL_UINT32(check, user_data)     | `check` passes for all 2^32 `uint32_t` values    |
+//   | EXPECT_FOR_ALL_FLOAT32(check, user_data)    | `check` passes for all 2^32 `float` bit patterns |
+//   | EXPECT_FOR_RANGE(domain, first, last, ...)  | `check` passes for inputs `first` to `last`      |
+//
+//   The domain is split into chunks checked in parallel on all cores. `check`
+//   has the type `rktest_sweep_fn` and is called with batches of consecutive
+//   inputs, so that it can compare a vectorized kernel against a reference.
+//   It sets `failed[i]` for each input that is wrong, rather than using other
+//   assertions, since it runs on several threads:
+//
+//      static void check_fast_exp(const void* inputs, bool* failed, size_t count, void* user_data) {
+//          const float* x = inputs;
+//          float y[RKTEST_SWEEP_BATCH_SIZE];
+//          fast_exp(x, y, count);
+//          for (size_t i = 0; i < count; i++) {
+//              failed[i] = !isnan(x[i]) && !rktest_floats_within_4_ulp(y[i], expf(x[i]));
+//          }
+//      }
+//
+//      TEST(math_tests, fast_exp_is_accurate) {
+//          EXPECT_FOR_ALL_FLOAT32(check_fast_exp, NULL);
+//      }
+//
+//   A failing sweep reports the number of failing inputs and the smallest of
+//   them. For EXPECT_FOR_RANGE(), `domain` is RKTEST_DOMAIN_UINT16,
+//   RKTEST_DOMAIN_UINT32 or RKTEST_DOMAIN_FLOAT32, and a float range is given
+//   as bit patterns, e.g. 0x3f800000 to 0x3fffffff for [1, 2).
+//
+//   Statistical assertions:
+//   | Macro name                                                          | Assertion                                       |
+//   | ------------------------------------------------------------------- | ----------------------------------------------- |
+//   | EXPECT_UNIFORM(sample, user_data, n, num_buckets)                   | Bucket indices drawn by `sample` are uniform    |
+//   | EXPECT_CHI_SQUARE(sample, user_data, n, p, num_buckets)             | Bucket indices fit the bucket probabilities `p` |
+//   | EXPECT_KOLMOGOROV_SMIRNOV(sample, user_data, n, cdf, cdf_user_data) | Samples fit the distribution function `cdf`     |
+//
+//   `sample` has the type `rktest_sample_fn` and fills batches of samples
+//   using the given seed, so that `n` samples can be drawn in parallel on all
+//   cores and still be the same from run to run:
+//
+//      static void sample_bucket(double* samples, size_t count, uint64_t seed, void* user_data) {
+//          rng_t rng = rng_new(seed);
+//          for (size_t i = 0; i < count; i++) {
+//              samples[i] = hash_u64(rng_next(&rng)) % 64;
+//          }
+//      }
+//
+//      TEST(hash_tests, hash_fills_buckets_evenly) {
+//          EXPECT_UNIFORM(sample_bucket, NULL, 100000000, 64);
+//      }
+//
+//   Assertions fail if the p-value of the chi-square or Kolmogorov-Smirnov
+//   test is below the threshold set with `--rktest_p_value`.
+//
+// BENCHMARKS
+//
+//   Benchmarks are defined with the BENCHMARK() macro, which like TEST() takes
+//   a suite name and a benchmark name. The body receives a `rktest_bench_t*
+//   bench` and should run the code to measure in a `rktest_bench_loop()` loop:
+//
+//      BENCHMARK(hash_benchmarks, hash_short_string) {
+//          while (rktest_bench_loop(bench)) {
+//              uint32_t hash = hash_string("hello");
+//              RKTEST_DO_NOT_OPTIMIZE(hash);
+//          }
+//      }
+//
+//   Benchmarks are not run together with the tests, but only when passing
+//   `--rktest_benchmark=PATTERN`. Every iteration of the loop is timed and
+//   recorded into a log-bucketed histogram with a relative error below 1.6%,
+//   from which the mean and the p50/p90/p99/p99.9 latencies are reported.
+//
+//   For very short operations, `rktest_bench_set_batch_size(bench, n)` can be
+//   called before the loop to only read the clock every `n` iterations.
+//
+//   Work that should not be timed, like resetting state, can be put between
+//   `rktest_bench_pause(bench)` and `rktest_bench_resume(bench)`. Since that
+//   reads the clock twice more per iteration, benchmarks that need fresh inputs
+//   for every operation should rather prepare them `k` at a time, untimed, and
+//   then time the `k` operations together:
+//
+//      BENCHMARK(heap_benchmarks, pop_min) {
+//          heap_t heaps[64];
+//          while (rktest_bench_batch_setup(bench, 64)) {
+//              for (int i = 0; i < 64; i++) {
+//                  build_heap(&heaps[i]);
+//              }
+//              rktest_bench_batch_start(bench);
+//              for (int i = 0; i < 64; i++) {
+//                  heap_pop_min(&heaps[i]);
+//              }
+//          }
+//      }
+//
+//   A benchmark that never calls `rktest_bench_batch_start(bench)` stops after
+//   the minimum benchmark time and fails.
+//
+//   BENCHMARK_F() defines a benchmark that runs once for each of the given
+//   integer arguments, which the body reads with `rktest_bench_arg(bench)`.
+//   Expensive inputs are built by the suite's BENCHMARK_SETUP(), which runs
+//   once per argument and is kept across repetitions, rate sweep steps and the
+//   other benchmarks of the suite. BENCHMARK_TEARDOWN() only runs when moving on
+//   to another argument, and after the last benchmark:
+//
+//      static char* g_input;
+//
+//      BENCHMARK_SETUP(sort_benchmarks) {
+//          g_input = make_random_input(arg);
+//      }
+//
+//      BENCHMARK_TEARDOWN(sort_benchmarks) {
+//          free(g_input);
+//      }
+//
+//      BENCHMARK_F(sort_benchmarks, sort_copy, 1 << 10, 1 << 20, 500 << 20) {
+//          while (rktest_bench_loop(bench)) {
+//              sort_copy(g_input, rktest_bench_arg(bench));
+//          }
+//      }
+//
+//   TYPED_BENCHMARK() stamps out one benchmark per type of a type list, each
+//   compiled for its own type. The body is given as a function-like macro of
+//   the type, and each instance is named after its type, e.g. `sum<int8_t>`:
+//
+//      #define SUM_BENCHMARK(T) while (rktest_bench_loop(bench)) { RKTEST_DO_NOT_OPTIMIZE(sum_##T(g_values_##T, 1024)); }
+//
+//      TYPED_BENCHMARK(sum_benchmarks, sum, RKTEST_NUMERIC_TYPES, SUM_BENCHMARK)
+//
+//   Kernels whose speed depends on the alignment of their inputs should get
+//   their buffers from `rktest_bench_buffer(bench, size)`, which are freed after
+//   the benchmark. They are page aligned by default, and with
+//   `--rktest_benchmark_alignment_sweep=STRIDE` the benchmark is run with its
+//   buffers at every STRIDE bytes offset from 0 to 63 from page alignment,
+//   reporting the best, median and worst offsets and all the slow ones.
+//
+//   Memory-heavy benchmarks can get their inputs from `rktest_bench_alloc(bench,
+//   size, flags)`, which is also freed after the benchmark, to keep page faults
+//   and TLB misses out of the measurement. The flags are:
+//
+//      | Flag                          | Description                                         |
+//      |-------------------------------|-----------------------------------------------------|
+//      | RKTEST_ALLOC_PREFAULT         | Fault all pages in before returning (MAP_POPULATE)  |
+//      | RKTEST_ALLOC_HUGE_PAGES       | Ask for transparent huge pages (MADV_HUGEPAGE)      |
+//      | RKTEST_ALLOC_HUGETLB          | Use reserved hugetlbfs pages (MAP_HUGETLB)          |
+//      | RKTEST_ALLOC_NUMA_NODE(node)  | Bind the memory to a NUMA node (mbind)              |
+//
+//   Whatever cannot be had falls back to normal pages, and the amount of memory
+//   actually backed by huge pages is reported with the results. Only Linux
+//   supports the flags, elsewhere this is a plain malloc().
+//
+//   BENCHMARK_RATE() instead defines an open-loop benchmark, where each loop
+//   iteration is started on a fixed schedule of `ops_per_sec` operations per
+//   second. Latency is measured from the scheduled start of an operation rather
+//   than its actual start, so that time spent queued behind slow operations is
+//   included (avoiding "coordinated omission"):
+//
+//      BENCHMARK_RATE(server_benchmarks, handle_request, 10000) {
+//          while (rktest_bench_loop(bench)) {
+//              handle_request(&g_request);
+//          }
+//      }
+//
+//   With `--rktest_benchmark_rate_sweep=yes`, rate benchmarks are repeated with
+//   the rate doubled each time until the achieved throughput or tail latency
+//   shows that the code under test is saturated.
+//
+// TYPED TESTS
+//
+//   TYPED_TEST() is to TEST() what TYPED_BENCHMARK() is to BENCHMARK(): the body
+//   is a function-like macro that is expanded once for every type of the list,
+//   so each instance is compiled for its type without any runtime dispatch:
+//
+//      #define SUM_IS_CORRECT(T) T values[] = { 1, 2, 3 }; EXPECT_EQ((int)sum_##T(values, 3), 6);
+//
+//      TYPED_TEST(sum_tests, sum_is_correct, RKTEST_NUMERIC_TYPES, SUM_IS_CORRECT)
+//
+//   RKTEST_INTEGER_TYPES, RKTEST_FLOATING_POINT_TYPES and RKTEST_NUMERIC_TYPES
+//   are predefined type lists. A type list is an X-macro that passes each type,
+//   followed by its other arguments, to X:
+//
+//      #define UNSIGNED_TYPES(X, ...) X(uint8_t, __VA_ARGS__) X(uint64_t, __VA_ARGS__)
+//
+//   Types have to be single identifiers, so e.g. `unsigned int` needs a typedef.
+//
+// TEST DEPENDENCIES
+//
+//   TEST_DEPENDS() defines a test that only makes sense if other tests passed.
+//   It takes the full names of its prerequisites after the test name:
+//
+//      TEST_DEPENDS(storage_tests, reads_back_record, "storage_tests.opens_database") {
+//          EXPECT_TRUE(read_record(db, 1) != NULL);
+//      }
+//
+//   Prerequisites run before the tests that depend on them, also across test
+//   suites. If a prerequisite fails or is skipped, its dependents are skipped
+//   and listed as SKIPPED instead of failing with unrelated errors. So are the
+//   dependents of disabled prerequisites and of prerequisites excluded by
+//   `--rktest_filter`, since those never run. A prerequisite split into
+//   instances, by TEST_ISA() or `--rktest_shards`, only passes if all of its
+//   instances passed.
+//
+// CACHED TEST DATA
+//
+//   Large deterministic inputs, like synthetic graphs or compressed corpora,
+//   can be generated once and reused by later runs with rktest_cached_data().
+//   It runs the generator the first time a key is used, writes its output to
+//   the cache directory, and memory maps the cached file read-only:
+//
+//      static void generate_graph(FILE* file) {
+//          for (uint32_t i = 0; i < 10000000; i++) {
+//              edge_t edge = random_edge(i);
+//              fwrite(&edge, sizeof(edge), 1, file);
+//          }
+//      }
+//
+//      TEST(graph_tests, finds_shortest_path) {
+//          size_t size;
+//          const edge_t* edges = rktest_cached_data("graph_10m", 1, generate_graph, &size);
+//          EXPECT_EQ(shortest_path(edges, size / sizeof(edge_t), 0, 42), 7);
+//      }
+//
+//   The data stays mapped until the test program exits, and is returned
+//   without remapping when the key and version are used again. Cached data
+//   is regenerated when the version passed with the key changes, or when the
+//   test program is rebuilt (detected by its GNU build-id on Linux, or by the
+//   size and modification time of the executable elsewhere).
+//
+// MULTI-ISA TESTS
+//
+//   Code that dispatches at runtime between e.g. scalar, AVX2 and AVX-512
+//   implementations is normally only tested with the path picked for the
+//   machine running the tests. TEST_ISA() defines a test that is instead run
+//   once per instruction set level the machine supports, with the dispatch
+//   overridden by a hook defined with RKTEST_ISA_HOOK():
+//
+//      RKTEST_ISA_HOOK(isa) {
+//          force_dispatch_level(isa);
+//      }
+//
+//      TEST_ISA(kernel_tests, sums_floats) {
+//          EXPECT_FLOAT_EQ(sum_floats(values, 64), 2080.0f);
+//      }
+//
+//   The hook receives one of RKTEST_ISA_SCALAR, RKTEST_ISA_SSE42,
+//   RKTEST_ISA_AVX2 or RKTEST_ISA_AVX512, and each instance is named and timed
+//   after its level, e.g. `kernel_tests.sums_floats[avx2]`. After an instance
+//   the hook is called again with the highest level supported, so that other
+//   tests see the dispatch the machine would normally pick. Tests can get the
+//   level of the running instance with `rktest_current_isa()`. Levels above
+//   scalar are only detected on x86 with GCC and Clang.
+//
+// SUBTESTS
+//
+//   RKTEST_SUBTEST() runs the statement or block following it as a subtest of
+//   the current test, with its own outcome, duration and name, given as a
+//   printf format. Data-driven tests can run each row as a subtest:
+//
+//      TEST(parser_tests, parses_table_rows) {
+//          for (size_t i = 0; i < num_rows; i++) {
+//              RKTEST_SUBTEST("row_%zu", i) {
+//                  EXPECT_EQ(parse_int(rows[i].input), rows[i].expected);
+//              }
+//          }
+//      }
+//
+//   Each subtest is reported as e.g. `parser_tests.parses_table_rows/row_7`,
+//   and its failures fail both the subtest and the test. A test filter with a
+//   slash only runs the matching subtests, e.g.
+//   `--rktest_filter=parser_tests.parses_table_rows/row_7`. Failing ASSERT_*,
+//   RKTEST_SKIP() and RKTEST_REQUIRE() end the whole test, so use EXPECT_* to
+//   keep going with the following subtests. Subtests can not be nested.
+//
+// DATA-DRIVEN TESTS
+//
+//   TEST_DATA() defines a test that runs once for every record of a case file,
+//   with one record per line, like JSON Lines or CSV files. The file is memory
+//   mapped and the body gets each record as a view into the mapping, without
+//   copying it. Relative paths are resolved against `--rktest_data_dir`, else
+//   against RKTEST_DATA_DIR if the build defines it, e.g. as
+//   `-DRKTEST_DATA_DIR=\"/path/to/tests\"`, else against the directory of the
+//   source file defining the test, which only exists where it was compiled:
+//
+//      TEST_DATA(parser_tests, conformance, "cases/parse_int.jsonl") {
+//          case_t c = parse_case(record->data, record->size);
+//          EXPECT_EQ(parse_int(c.input), c.expected);
+//      }
+//
+//   Each record runs as a subtest named after its line number, e.g.
+//   `parser_tests.conformance/line_12`, and a failing ASSERT_* or RKTEST_SKIP()
+//   only ends that record. Empty lines are skipped, and so is the header line
+//   of files ending in `.csv`. With `--rktest_shards=N` every TEST_DATA()
+//   is split into N instances of the same suite, e.g. `conformance[2of4]`,
+//   that each run every Nth record, so a filter like `--rktest_filter=*[2of4]`
+//   runs a part of the records in each of several processes.
+//
+// INDEXED TESTS
+//
+//   TEST_INDEXED() defines a test with a parameter space of up to 2^64
+//   instances, enumerated lazily by index so no memory is spent per instance.
+//   The body derives its parameters from `index`:
+//
+//      static void format_shift_name(char* buf, size_t size, uint64_t index) {
+//          snprintf(buf, size, "shift_%d_of_%u", (int)(index % 32), (unsigned)(index / 32));
+//      }
+//
+//      TEST_INDEXED(bit_tests, rotates_back, 32ull << 20, &format_shift_name) {
+//          const uint32_t value = (uint32_t)(index / 32);
+//          const int shift = (int)(index % 32);
+//          EXPECT_EQ(rotate_right(rotate_left(value, shift), shift), value);
+//      }
+//
+//   Instance names are only formatted to match a filter or to report a
+//   failing or skipped instance, e.g. `bit_tests.rotates_back/shift_3_of_17`.
+//   Passing the name formatter as NULL names instances by their index. Passing
+//   instances are not printed, and a failing ASSERT_* or RKTEST_SKIP() only
+//   ends that instance. With `--rktest_shards=N` every TEST_INDEXED() is
+//   split into N instances of the same suite running a contiguous Nth of the
+//   indices.
+//
+// RUNTIME REGISTRATION
+//
+//   Tests only known at runtime, like one per file in a directory, can be
+//   added with rktest_register_test() from a hook defined with
+//   RKTEST_REGISTRATION_HOOK(). The hooks run before any test, and the tests
+//   they register are filtered, run and reported like TEST() tests. The test
+//   function gets the context pointer it was registered with:
+//
+//      static void runs_spec_case(void* context) {
+//          const spec_case_t* spec_case = context;
+//          EXPECT_EQ(run_spec(spec_case->input), spec_case->expected);
+//      }
+//
+//      RKTEST_REGISTRATION_HOOK(spec_cases) {
+//          for (size_t i = 0; i < num_spec_cases; i++) {
+//              rktest_register_test("spec_tests", spec_cases[i].name, &runs_spec_case, &spec_cases[i]);
+//          }
+//      }
+//
+//   The names are copied, but the context must outlive the test run.
+//
+// SKIPPING TESTS
+//
+//   RKTEST_SKIP() stops the current test and reports it as skipped, e.g. when
+//   the machine lacks something the test needs:
+//
+//      TEST(ring_tests, submits_read) {
+//          if (!ring_init(&ring)) {
+//              RKTEST_SKIP("io_uring is not available");
+//          }
+//      }
+//
+//   Capabilities needed by many tests are better defined once as a probe with
+//   RKTEST_PROBE() and required with RKTEST_REQUIRE(). Each probe runs at most
+//   once per test run, the first time a test requires it, and its result is
+//   cached for the tests that follow. With `--rktest_jobs=N` the cache is per
+//   worker process, so a probe can run once in each worker:
+//
+//      RKTEST_PROBE(avx512f) {
+//          return __builtin_cpu_supports("avx512f");
+//      }
+//
+//      TEST(simd_tests, sums_16_floats) {
+//          RKTEST_REQUIRE(avx512f);
+//          EXPECT_FLOAT_EQ(sum_16_floats_avx512(values), 136.0f);
+//      }
+//
+//   Using RKTEST_REQUIRE() in TEST_SETUP() skips every test of the suite.
+//   Skipped tests do not fail the test run, but are counted and listed after
+//   the test summary.
+//
+// PARALLEL TESTS
+//
+//   With `--rktest_jobs=N` the test suites are run by N forked worker processes,
+//   each taking the next suite that has not been started. The output of every
+//   suite is printed in the usual order once all workers are done, and a test
+//   waits for prerequisites from TEST_DEPENDS() that another worker is running,
+//   for up to RKTEST_PREREQUISITE_TIMEOUT_S seconds. If no worker can be
+//   started, the tests run in-process.
+//
+//   Large read-only inputs shared by the tests of a suite are built once by its
+//   SHARED_SETUP(), which runs in the parent process before any worker starts.
+//   Memory from `rktest_shared_alloc(size)` is then made read-only and mapped by
+//   every worker at the same address, so the memory used by such inputs does
+//   not grow with the number of workers:
+//
+//      static const uint32_t* g_lookup_table;
+//
+//      SHARED_SETUP(lookup_tests) {
+//          uint32_t* table = rktest_shared_alloc(TABLE_SIZE * sizeof(uint32_t));
+//          build_lookup_table(table);
+//          g_lookup_table = table;
+//      }
+//
+//      TEST(lookup_tests, finds_every_key) {
+//          EXPECT_TRUE(lookup_all(g_lookup_table, keys, num_keys));
+//      }
+//
+//   SHARED_SETUP() also runs once, before the tests, without `--rktest_jobs`.
+//   If it fails or skips, so does every test of its suite, without running.
+//   Shared memory is released when the test program exits.
+//
+// SUITE FIXTURES
+//
+//   Unlike TEST_SETUP() and TEST_TEARDOWN(), which run around every test,
+//   SUITE_SETUP() runs once before the first test of a suite and
+//   SUITE_TEARDOWN() once after its last test, e.g. to start a local server
+//   that all tests of the suite talk to:
+//
+//      SUITE_SETUP(http_tests) {
+//          ASSERT_TRUE(start_local_server(&g_server));
+//      }
+//
+//      SUITE_TEARDOWN(http_tests) {
+//          stop_local_server(&g_server);
+//      }
+//
+//   If SUITE_SETUP() fails or skips, so does every test of the suite, without
+//   running. A failing SUITE_TEARDOWN() is reported as `suite.SUITE_TEARDOWN`.
+//
+//   Fixtures that only touch state of their own suite can be declared with
+//   INDEPENDENT_SUITE_SETUP() and INDEPENDENT_SUITE_TEARDOWN() instead. With
+//   `--rktest_pipeline_fixtures=yes`, the setup of the next suite then runs on
+//   a background thread while the current suite runs, and teardowns run on
+//   background threads that are waited for at the end of the test run, which
+//   hides the latency of slow fixtures. Their output may be interleaved with
+//   the output of the suite running at the same time. Pipelining is turned off
+//   with `--rktest_oom_sweep`, `--rktest_leak_check` and `--rktest_jobs`.
+//
 // OPTIONS
 //
 //   The unit test binary built with RK Test can take command line arguments:
@@ -141,9 +575,120 @@
 //
 //      --rktest_print_filenames=0
 //        Disable printing out the filename of a test case on assert failure.
+//
+//      --rktest_p_value=P
+//        Fail statistical assertions whose samples have a p-value below P,
+//        i.e. a chance below P to be drawn from the expected distribution. The
+//        default is 0.001.
+//
+//      --rktest_progress=(yes|no|auto)
+//        Replace the per test output with a single status line showing progress,
+//        failures so far and an estimated time left, printing full output only
+//        for failing tests. Test durations are stored in the cache directory
+//        and used to estimate the time left of later runs. The default is no,
+//        and auto enables it if the output is a terminal.
+//
+//      --rktest_oom_sweep=PATTERN
+//        For each test matching the globbing pattern, fork the test process at
+//        every allocation the test makes and let the allocation fail in the
+//        child, reporting allocation failures that crash or leak memory. Only
+//        the test body on the test thread is affected, not RK Test functions
+//        it calls. Needs RK Test to be built with `RKTEST_INTERPOSE_MALLOC` defined (the CMake
+//        option `rktest_interpose_malloc`) and is only supported with glibc.
+//
+//      --rktest_isa_max=(scalar|sse4.2|avx2|avx512)
+//        Run TEST_ISA() tests only at instruction set levels up to the given
+//        one, e.g. to reproduce the results of a machine without AVX-512. The
+//        default is to run at every level the machine supports.
+//
+//      --rktest_cache_dir=DIR
+//        Directory of the data cached by rktest_cached_data() and of the test
+//        durations of the progress line. The default is `<executable>.cache`,
+//        or `rktest-<executable>.cache` in the temp directory if the directory
+//        of the executable is read-only.
+//
+//      --rktest_data_dir=DIR
+//        Directory that relative TEST_DATA() paths are resolved against. The
+//        default is RKTEST_DATA_DIR if it is defined, else the directory of the
+//        source file defining the test.
+//
+//      --rktest_jobs=N
+//        Run the test suites in N worker processes. The default is 1, which
+//        runs them in the test process. Not supported on Windows, and the
+//        progress line and instruction counting are only available with 1.
+//
+//      --rktest_shards=N
+//        Split every TEST_DATA() and TEST_INDEXED() into N instances running
+//        every Nth record or a contiguous Nth of the indices. The default is 1.
+//        `--rktest_data_shards=N` is accepted as its former name.
+//
+//      --rktest_pipeline_fixtures=(yes|no)
+//        Run INDEPENDENT_SUITE_SETUP() of the next suite while the current
+//        suite runs, and INDEPENDENT_SUITE_TEARDOWN() in the background.
+//        Ignored with --rktest_oom_sweep, --rktest_leak_check and
+//        --rktest_jobs. The default is no.
+//
+//      --rktest_benchmark=PATTERN
+//        Run the benchmarks that matches the globbing pattern instead of tests.
+//
+//      --rktest_benchmark_min_time=SECONDS
+//        Run each benchmark loop for at least this many seconds. The default is
+//        0.5 seconds.
+//
+//      --rktest_benchmark_repetitions=N
+//        Run each benchmark (and argument) N times, reporting every repetition
+//        and their aggregate. The default is 1.
+//
+//      --rktest_benchmark_rate_sweep=(yes|no)
+//        Run BENCHMARK_RATE() benchmarks at doubling rates until saturated, to
+//        find the highest sustainable rate. The default is no.
+//
+//      --rktest_benchmark_alignment_sweep=STRIDE
+//        Run benchmarks using rktest_bench_buffer() with their buffers at every
+//        STRIDE bytes offset from 0 to 63 from page alignment, repeating each
+//        offset `--rktest_benchmark_repetitions` times. The default is to only
+//        run with page aligned buffers.
+//
+//      --rktest_benchmark_isolation=(none|process)
+//        With process, run every benchmark (and repetition) in a forked child
+//        process, so that its results do not depend on the heap, cache and
+//        other state left behind by the benchmarks that ran before it. Setup
+//        from BENCHMARK_SETUP() still runs in the parent and is inherited. Not
+//        supported on Windows. The default is none.
+//
+//      --rktest_benchmark_json=FILE
+//        Write the benchmark results, including their latency histograms, as
+//        JSON to FILE.
+//
+//      --rktest_leak_check=(off|report|fail)
+//        Compare the open file descriptors and running threads before and after
+//        each test, and report (or fail the test on) any that were leaked. Only
+//        supported on Linux. The default is off.
+//
+//      --rktest_perf_counters=(off|instructions|caches)
+//        Count the instructions retired by each test (and by each benchmark
+//        iteration) with perf_event_open(), and with caches also the L1 data
+//        and last level cache misses. Only supported on Linux, and only where
+//        hardware counters are available. The default is off.
+//
+//      --rktest_perf_save=FILE
+//        Save the counts to FILE, to be used as a baseline by later runs. Like
+//        --rktest_perf_baseline, exits with an error if hardware counters are
+//        not available.
+//
+//      --rktest_perf_baseline=FILE
+//        Fail the tests and benchmarks that retire more instructions than
+//        saved in FILE by more than the threshold. Unlike times, instruction
+//        counts hardly vary between runs, even on busy CI machines.
+//
+//      --rktest_perf_threshold=PERCENT
+//        Allowed growth of the instruction count over the baseline. The default
+//        is 1 percent.
 
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -153,6 +698,25 @@
 /* Public API --------------------------------------------------------------- */
 int rktest_main(int argc, const char* argv[]);
 
+typedef struct rktest_bench rktest_bench_t;
+bool rktest_bench_loop(rktest_bench_t* bench);
+void rktest_bench_set_batch_size(rktest_bench_t* bench, size_t batch_size);
+void rktest_bench_pause(rktest_bench_t* bench);
+void rktest_bench_resume(rktest_bench_t* bench);
+bool rktest_bench_batch_setup(rktest_bench_t* bench, size_t batch_size);
+void rktest_bench_batch_start(rktest_bench_t* bench);
+int64_t rktest_bench_arg(const rktest_bench_t* bench);
+void* rktest_bench_buffer(rktest_bench_t* bench, size_t size);
+void* rktest_bench_alloc(rktest_bench_t* bench, size_t size, int flags);
+
+// Flags of rktest_bench_alloc()
+enum {
+	RKTEST_ALLOC_PREFAULT = 1 << 0,
+	RKTEST_ALLOC_HUGE_PAGES = 1 << 1,
+	RKTEST_ALLOC_HUGETLB = 1 << 2,
+};
+#define RKTEST_ALLOC_NUMA_NODE(NODE) (((NODE) + 1) << 8)
+
 #define TEST(SUITE, NAME)                                                              \
 	void SUITE##_##NAME##_impl(void);                                                  \
 	const rktest_test_t SUITE##_##NAME##_data = {                                      \
@@ -165,6 +729,99 @@ int rktest_main(int argc, const char* argv[]);
 	ADD_TO_MEMORY_SECTION_END                                                          \
 	void SUITE##_##NAME##_impl(void)
 
+// Base directory of relative TEST_DATA() paths, defined by the build, e.g. as the
+// source directory. Without it they are relative to the directory of __FILE__.
+#ifndef RKTEST_DATA_DIR
+#define RKTEST_DATA_DIR NULL
+#endif
+
+#define TEST_DATA(SUITE, NAME, PATH)                                                   \
+	void SUITE##_##NAME##_impl(const rktest_record_t* record);                         \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.run_record = &SUITE##_##NAME##_impl,                                          \
+		.data_path = PATH,                                                             \
+		.data_dir = RKTEST_DATA_DIR,                                                   \
+		.source_path = __FILE__                                                        \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(const rktest_record_t* record)
+
+#define TEST_INDEXED(SUITE, NAME, COUNT, FORMAT_NAME)                                    \
+	void SUITE##_##NAME##_impl(uint64_t index);                                          \
+	const rktest_test_t SUITE##_##NAME##_data = {                                        \
+		.suite_name = #SUITE,                                                            \
+		.test_name = #NAME,                                                              \
+		.run_index = &SUITE##_##NAME##_impl,                                             \
+		.num_indices = (COUNT),                                                          \
+		.format_index_name = (FORMAT_NAME)                                               \
+	};                                                                                   \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                          \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data;   \
+	ADD_TO_MEMORY_SECTION_END                                                            \
+	void SUITE##_##NAME##_impl(uint64_t index)
+
+#define TEST_DEPENDS(SUITE, NAME, ...)                                                 \
+	void SUITE##_##NAME##_impl(void);                                                  \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.run = &SUITE##_##NAME##_impl,                                                 \
+		.prerequisites = (const char* const[]){ __VA_ARGS__, NULL }                    \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(void)
+
+#define TEST_ISA(SUITE, NAME)                                                          \
+	void SUITE##_##NAME##_impl(void);                                                  \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.run = &SUITE##_##NAME##_impl,                                                 \
+		.is_isa_test = true                                                            \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(void)
+
+#define RKTEST_ISA_HOOK(ISA)                                                     \
+	void rktest_isa_hook_impl(rktest_isa_t ISA);                                 \
+	const rktest_test_t rktest_isa_hook_data = {                                 \
+		.isa_hook = &rktest_isa_hook_impl                                        \
+	};                                                                           \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                  \
+	const rktest_test_t* const rktest_isa_hook_data_ptr = &rktest_isa_hook_data; \
+	ADD_TO_MEMORY_SECTION_END                                                    \
+	void rktest_isa_hook_impl(rktest_isa_t ISA)
+
+#define RKTEST_PROBE(NAME)                                                                   \
+	bool rktest_probe_##NAME##_impl(void);                                                   \
+	const rktest_test_t rktest_probe_##NAME##_data = {                                       \
+		.test_name = #NAME,                                                                  \
+		.probe = &rktest_probe_##NAME##_impl                                                 \
+	};                                                                                       \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                              \
+	const rktest_test_t* const rktest_probe_##NAME##_data_ptr = &rktest_probe_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                                \
+	bool rktest_probe_##NAME##_impl(void)
+
+#define RKTEST_REGISTRATION_HOOK(NAME)                                                                           \
+	void rktest_registration_hook_##NAME##_impl(void);                                                           \
+	const rktest_test_t rktest_registration_hook_##NAME##_data = {                                               \
+		.test_name = #NAME,                                                                                      \
+		.registration_hook = &rktest_registration_hook_##NAME##_impl                                             \
+	};                                                                                                           \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                                  \
+	const rktest_test_t* const rktest_registration_hook_##NAME##_data_ptr = &rktest_registration_hook_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                                                    \
+	void rktest_registration_hook_##NAME##_impl(void)
+
 #define TEST_SETUP(SUITE)                                                            \
 	void SUITE##_##setup(void);                                                      \
 	const rktest_test_t SUITE##_##setup##_data = {                                   \
@@ -187,6 +844,139 @@ int rktest_main(int argc, const char* argv[]);
 	ADD_TO_MEMORY_SECTION_END                                                              \
 	void SUITE##_teardown(void)
 
+#define SUITE_SETUP(SUITE) RKTEST_SUITE_FIXTURE(SUITE, suite_setup, false)
+#define SUITE_TEARDOWN(SUITE) RKTEST_SUITE_FIXTURE(SUITE, suite_teardown, false)
+#define INDEPENDENT_SUITE_SETUP(SUITE) RKTEST_SUITE_FIXTURE(SUITE, suite_setup, true)
+#define INDEPENDENT_SUITE_TEARDOWN(SUITE) RKTEST_SUITE_FIXTURE(SUITE, suite_teardown, true)
+
+#define RKTEST_SUITE_FIXTURE(SUITE, KIND, IS_INDEPENDENT)                                 \
+	void SUITE##_##KIND(void);                                                            \
+	const rktest_test_t SUITE##_##KIND##_data = {                                         \
+		.suite_name = #SUITE,                                                             \
+		.KIND = &SUITE##_##KIND,                                                          \
+		.is_independent_fixture = IS_INDEPENDENT                                          \
+	};                                                                                    \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                           \
+	const rktest_test_t* const SUITE##_##KIND##_data##_##ptr = &SUITE##_##KIND##_data;    \
+	ADD_TO_MEMORY_SECTION_END                                                             \
+	void SUITE##_##KIND(void)
+
+#define SHARED_SETUP(SUITE)                                                                        \
+	void SUITE##_##shared_setup(void);                                                             \
+	const rktest_test_t SUITE##_##shared_setup##_data = {                                          \
+		.suite_name = #SUITE,                                                                      \
+		.shared_setup = &SUITE##_##shared_setup                                                    \
+	};                                                                                             \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                    \
+	const rktest_test_t* const SUITE##_##shared_setup##_data##_##ptr = &SUITE##_shared_setup_data; \
+	ADD_TO_MEMORY_SECTION_END                                                                      \
+	void SUITE##_shared_setup(void)
+
+#define BENCHMARK(SUITE, NAME)                                                         \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench);                                 \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.bench = &SUITE##_##NAME##_impl                                                \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench)
+
+#define BENCHMARK_F(SUITE, NAME, ...)                                                  \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench);                                 \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.bench = &SUITE##_##NAME##_impl,                                               \
+		.bench_args = (const int64_t[]){ __VA_ARGS__ },                                \
+		.num_bench_args = sizeof((const int64_t[]){ __VA_ARGS__ }) / sizeof(int64_t)   \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench)
+
+#define BENCHMARK_SETUP(SUITE)                                                                   \
+	void SUITE##_##bench_setup(int64_t arg);                                                     \
+	const rktest_test_t SUITE##_##bench_setup##_data = {                                         \
+		.suite_name = #SUITE,                                                                    \
+		.bench_setup = &SUITE##_##bench_setup                                                    \
+	};                                                                                           \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                  \
+	const rktest_test_t* const SUITE##_##bench_setup##_data##_##ptr = &SUITE##_bench_setup_data; \
+	ADD_TO_MEMORY_SECTION_END                                                                    \
+	void SUITE##_bench_setup(int64_t arg)
+
+#define BENCHMARK_TEARDOWN(SUITE)                                                                      \
+	void SUITE##_##bench_teardown(int64_t arg);                                                        \
+	const rktest_test_t SUITE##_##bench_teardown##_data = {                                            \
+		.suite_name = #SUITE,                                                                          \
+		.bench_teardown = &SUITE##_##bench_teardown                                                    \
+	};                                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                        \
+	const rktest_test_t* const SUITE##_##bench_teardown##_data##_##ptr = &SUITE##_bench_teardown_data; \
+	ADD_TO_MEMORY_SECTION_END                                                                          \
+	void SUITE##_bench_teardown(int64_t arg)
+
+// Type lists for TYPED_TEST() and TYPED_BENCHMARK()
+#define RKTEST_INTEGER_TYPES(X, ...) \
+	X(int8_t, __VA_ARGS__) X(int16_t, __VA_ARGS__) X(int32_t, __VA_ARGS__) X(int64_t, __VA_ARGS__)
+#define RKTEST_FLOATING_POINT_TYPES(X, ...) \
+	X(float, __VA_ARGS__) X(double, __VA_ARGS__)
+#define RKTEST_NUMERIC_TYPES(X, ...) \
+	RKTEST_INTEGER_TYPES(X, __VA_ARGS__) RKTEST_FLOATING_POINT_TYPES(X, __VA_ARGS__)
+
+#define TYPED_TEST(SUITE, NAME, TYPES, BODY) TYPES(RKTEST_TYPED_TEST_INSTANCE, SUITE, NAME, BODY)
+#define TYPED_BENCHMARK(SUITE, NAME, TYPES, BODY) TYPES(RKTEST_TYPED_BENCHMARK_INSTANCE, SUITE, NAME, BODY)
+
+#define RKTEST_TYPED_TEST_INSTANCE(TYPE, SUITE, NAME, BODY)                                              \
+	void SUITE##_##NAME##_##TYPE##_impl(void) {                                                          \
+		BODY(TYPE)                                                                                       \
+	}                                                                                                    \
+	const rktest_test_t SUITE##_##NAME##_##TYPE##_data = {                                               \
+		.suite_name = #SUITE,                                                                            \
+		.test_name = #NAME "<" #TYPE ">",                                                                \
+		.run = &SUITE##_##NAME##_##TYPE##_impl                                                           \
+	};                                                                                                   \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                          \
+	const rktest_test_t* const SUITE##_##NAME##_##TYPE##_data##_##ptr = &SUITE##_##NAME##_##TYPE##_data; \
+	ADD_TO_MEMORY_SECTION_END
+
+#define RKTEST_TYPED_BENCHMARK_INSTANCE(TYPE, SUITE, NAME, BODY)                                         \
+	void SUITE##_##NAME##_##TYPE##_impl(rktest_bench_t* bench) {                                         \
+		BODY(TYPE)                                                                                       \
+	}                                                                                                    \
+	const rktest_test_t SUITE##_##NAME##_##TYPE##_data = {                                               \
+		.suite_name = #SUITE,                                                                            \
+		.test_name = #NAME "<" #TYPE ">",                                                                \
+		.bench = &SUITE##_##NAME##_##TYPE##_impl                                                         \
+	};                                                                                                   \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                                          \
+	const rktest_test_t* const SUITE##_##NAME##_##TYPE##_data##_##ptr = &SUITE##_##NAME##_##TYPE##_data; \
+	ADD_TO_MEMORY_SECTION_END
+
+#define BENCHMARK_RATE(SUITE, NAME, OPS_PER_SEC)                                       \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench);                                 \
+	const rktest_test_t SUITE##_##NAME##_data = {                                      \
+		.suite_name = #SUITE,                                                          \
+		.test_name = #NAME,                                                            \
+		.bench = &SUITE##_##NAME##_impl,                                               \
+		.ops_per_sec = OPS_PER_SEC                                                     \
+	};                                                                                 \
+	ADD_TO_MEMORY_SECTION_BEGIN                                                        \
+	const rktest_test_t* const SUITE##_##NAME##_data##_##ptr = &SUITE##_##NAME##_data; \
+	ADD_TO_MEMORY_SECTION_END                                                          \
+	void SUITE##_##NAME##_impl(rktest_bench_t* bench)
+
+// Prevents the compiler from optimizing away the computation of `value`
+#if defined(__GNUC__)
+#define RKTEST_DO_NOT_OPTIMIZE(value) __asm__ volatile("" : : "r,m"(value) : "memory")
+#else
+#define RKTEST_DO_NOT_OPTIMIZE(value) rktest_do_not_optimize(&(value))
+#endif
+
 /* Bool checks */
 #define EXPECT_TRUE(expr) RKTEST_CHECK_BOOL(expr, true, RKTEST_CHECK_EXPECT, " ")
 #define EXPECT_FALSE(lhs) RKTEST_CHECK_BOOL(lhs, false, RKTEST_CHECK_EXPECT, " ")
@@ -275,6 +1065,26 @@ int rktest_main(int argc, const char* argv[]);
 #define ASSERT_DOUBLE_EQ(lhs, rhs) RKTEST_CHECK_FLOAT_EQ(double, lhs, rhs, rktest_doubles_within_4_ulp, RKTEST_CHECK_ASSERT, " ")
 #define ASSERT_DOUBLE_EQ_INFO(lhs, rhs, ...) RKTEST_CHECK_FLOAT_EQ(double, lhs, rhs, rktest_doubles_within_4_ulp, RKTEST_CHECK_ASSERT, __VA_ARGS__)
 
+/* Exhaustive sweeps */
+#define EXPECT_FOR_ALL_UINT16(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_UINT16, 0, UINT16_MAX, check, user_data, RKTEST_CHECK_EXPECT)
+#define EXPECT_FOR_ALL_UINT32(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_UINT32, 0, UINT32_MAX, check, user_data, RKTEST_CHECK_EXPECT)
+#define EXPECT_FOR_ALL_FLOAT32(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0, UINT32_MAX, check, user_data, RKTEST_CHECK_EXPECT)
+#define EXPECT_FOR_RANGE(domain, first, last, check, user_data) RKTEST_CHECK_FOR_RANGE(domain, first, last, check, user_data, RKTEST_CHECK_EXPECT)
+
+#define ASSERT_FOR_ALL_UINT16(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_UINT16, 0, UINT16_MAX, check, user_data, RKTEST_CHECK_ASSERT)
+#define ASSERT_FOR_ALL_UINT32(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_UINT32, 0, UINT32_MAX, check, user_data, RKTEST_CHECK_ASSERT)
+#define ASSERT_FOR_ALL_FLOAT32(check, user_data) RKTEST_CHECK_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0, UINT32_MAX, check, user_data, RKTEST_CHECK_ASSERT)
+#define ASSERT_FOR_RANGE(domain, first, last, check, user_data) RKTEST_CHECK_FOR_RANGE(domain, first, last, check, user_data, RKTEST_CHECK_ASSERT)
+
+/* Statistical checks */
+#define EXPECT_UNIFORM(sample, user_data, num_samples, num_buckets) RKTEST_CHECK_P_VALUE(rktest_chi_square_p_value(sample, user_data, num_samples, NULL, num_buckets), sample, "a uniform distribution", RKTEST_CHECK_EXPECT)
+#define EXPECT_CHI_SQUARE(sample, user_data, num_samples, probabilities, num_buckets) RKTEST_CHECK_P_VALUE(rktest_chi_square_p_value(sample, user_data, num_samples, probabilities, num_buckets), sample, "the bucket probabilities `" #probabilities "`", RKTEST_CHECK_EXPECT)
+#define EXPECT_KOLMOGOROV_SMIRNOV(sample, user_data, num_samples, cdf, cdf_user_data) RKTEST_CHECK_P_VALUE(rktest_kolmogorov_smirnov_p_value(sample, user_data, num_samples, cdf, cdf_user_data), sample, "the distribution `" #cdf "`", RKTEST_CHECK_EXPECT)
+
+#define ASSERT_UNIFORM(sample, user_data, num_samples, num_buckets) RKTEST_CHECK_P_VALUE(rktest_chi_square_p_value(sample, user_data, num_samples, NULL, num_buckets), sample, "a uniform distribution", RKTEST_CHECK_ASSERT)
+#define ASSERT_CHI_SQUARE(sample, user_data, num_samples, probabilities, num_buckets) RKTEST_CHECK_P_VALUE(rktest_chi_square_p_value(sample, user_data, num_samples, probabilities, num_buckets), sample, "the bucket probabilities `" #probabilities "`", RKTEST_CHECK_ASSERT)
+#define ASSERT_KOLMOGOROV_SMIRNOV(sample, user_data, num_samples, cdf, cdf_user_data) RKTEST_CHECK_P_VALUE(rktest_kolmogorov_smirnov_p_value(sample, user_data, num_samples, cdf, cdf_user_data), sample, "the distribution `" #cdf "`", RKTEST_CHECK_ASSERT)
+
 /* String checks */
 #define EXPECT_STREQ(lhs, rhs) RKTEST_CHECK_STREQ(lhs, rhs, RKTEST_CHECK_EXPECT, RKTEST_MATCH_CASE, " ")
 #define EXPECT_STRNE(lhs, rhs) RKTEST_CHECK_STRNE(lhs, rhs, RKTEST_CHECK_EXPECT, RKTEST_MATCH_CASE, " ")
@@ -323,6 +1133,32 @@ int rktest_main(int argc, const char* argv[]);
 #error Trying to compile RK Test on an unsupported platform.
 #endif
 
+// Instruction set levels of TEST_ISA()
+typedef enum {
+	RKTEST_ISA_SCALAR,
+	RKTEST_ISA_SSE42,
+	RKTEST_ISA_AVX2,
+	RKTEST_ISA_AVX512,
+	RKTEST_ISA_COUNT,
+} rktest_isa_t;
+
+// Record of a TEST_DATA() case file, pointing into the memory mapped file
+typedef struct {
+	const char* data; // not NUL terminated
+	size_t size; // excluding the line break
+	size_t line; // line number in the file, starting at 1
+} rktest_record_t;
+
+// Formats the name of an instance of TEST_INDEXED()
+typedef void (*rktest_index_name_fn)(char* buf, size_t size, uint64_t index);
+
+typedef enum {
+	RKTEST_OUTCOME_NOT_RUN,
+	RKTEST_OUTCOME_PASSED,
+	RKTEST_OUTCOME_FAILED,
+	RKTEST_OUTCOME_SKIPPED,
+} rktest_outcome_t;
+
 // Collects all the information from a TEST() macro
 //
 // Instances of the struct are stored locally in the unit test files. Pointers
@@ -332,8 +1168,36 @@ typedef struct {
 	const char* suite_name;
 	const char* test_name;
 	void (*run)(void);
+	void (*run_record)(const rktest_record_t* record); // of TEST_DATA()
+	void (*run_with_context)(void* context); // of rktest_register_test()
+	void* context;
 	void (*setup)(void);
 	void (*teardown)(void);
+	void (*shared_setup)(void);
+	void (*suite_setup)(void);
+	void (*suite_teardown)(void);
+	void (*bench)(rktest_bench_t* bench);
+	void (*bench_setup)(int64_t arg);
+	void (*bench_teardown)(int64_t arg);
+	bool (*probe)(void);
+	void (*isa_hook)(rktest_isa_t isa);
+	void (*registration_hook)(void);
+	const int64_t* bench_args; // of BENCHMARK_F()
+	size_t num_bench_args;
+	double ops_per_sec; // open-loop rate of BENCHMARK_RATE(), zero if closed-loop
+	const char* const* prerequisites; // full test names of TEST_DEPENDS(), NULL terminated
+	const char* data_path; // case file of TEST_DATA()
+	const char* data_dir; // RKTEST_DATA_DIR where the TEST_DATA() is defined, or NULL
+	const char* source_path; // file defining the TEST_DATA()
+	void (*run_index)(uint64_t index); // of TEST_INDEXED()
+	uint64_t num_indices;
+	rktest_index_name_fn format_index_name;
+	size_t shard; // of this TEST_DATA() or TEST_INDEXED() instance
+	size_t num_shards;
+	rktest_outcome_t outcome;
+	rktest_isa_t isa; // of this TEST_ISA() instance
+	bool is_isa_test;
+	bool is_independent_fixture; // of INDEPENDENT_SUITE_SETUP() or INDEPENDENT_SUITE_TEARDOWN()
 	bool is_disabled;
 } rktest_test_t;
 
@@ -345,10 +1209,104 @@ typedef struct {
 #define RKTEST_MATCH_CASE true
 
 void rktest_fail_current_test(void);
+void rktest_skip_current_test(const char* reason);
+bool rktest_require(const char* probe_name);
+bool rktest_begin_subtest(const char* name_format, ...);
+bool rktest_end_subtest(void);
 bool rktest_string_is_number(const char* str);
 int rktest_strcasecmp(const char* lhs, const char* rhs);
 bool rktest_floats_within_4_ulp(float lhs, float rhs);
 bool rktest_doubles_within_4_ulp(double lhs, double rhs);
+void rktest_do_not_optimize(const volatile void* ptr);
+
+// Inputs of the exhaustive sweeps
+typedef enum {
+	RKTEST_DOMAIN_UINT16,
+	RKTEST_DOMAIN_UINT32,
+	RKTEST_DOMAIN_FLOAT32,
+} rktest_domain_t;
+
+#define RKTEST_SWEEP_BATCH_SIZE 1024 // max inputs per call of a rktest_sweep_fn
+
+typedef void (*rktest_sweep_fn)(const void* inputs, bool* failed, size_t count, void* user_data);
+uint64_t rktest_sweep(rktest_domain_t domain, uint32_t first, uint32_t last, rktest_sweep_fn check, void* user_data, uint32_t* failing_inputs, size_t* num_failing_inputs);
+void rktest_print_sweep_failure(rktest_domain_t domain, uint32_t first, uint32_t last, uint64_t num_failed, const uint32_t* failing_inputs, size_t num_failing_inputs);
+
+// Samplers and distributions of the statistical assertions
+typedef void (*rktest_sample_fn)(double* samples, size_t count, uint64_t seed, void* user_data);
+typedef double (*rktest_cdf_fn)(double x, void* user_data);
+double rktest_chi_square_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, const double* probabilities, size_t num_buckets);
+double rktest_kolmogorov_smirnov_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, rktest_cdf_fn cdf, void* cdf_user_data);
+double rktest_p_value_threshold(void);
+
+// Instruction set level of the running TEST_ISA() instance, else the highest supported
+rktest_isa_t rktest_current_isa(void);
+
+// Generator of data cached with rktest_cached_data()
+typedef void (*rktest_generator_fn)(FILE* file);
+const void* rktest_cached_data(const char* key, uint32_t version, rktest_generator_fn generate, size_t* size);
+
+// Allocates memory in SHARED_SETUP(), read-only and shared by all test processes
+void* rktest_shared_alloc(size_t size);
+
+// Adds a test in RKTEST_REGISTRATION_HOOK(), run with the given context
+typedef void (*rktest_test_fn)(void* context);
+void rktest_register_test(const char* suite_name, const char* test_name, rktest_test_fn run, void* context);
+
+#define RKTEST_SKIP(reason)               \
+	do {                                  \
+		rktest_skip_current_test(reason); \
+		return;                           \
+	} while (0)
+
+#define RKTEST_SUBTEST(...)                                                                  \
+	for (bool rktest_subtest_is_running = rktest_begin_subtest(__VA_ARGS__); rktest_subtest_is_running; \
+		rktest_subtest_is_running = rktest_end_subtest())
+
+#define RKTEST_REQUIRE(PROBE)          \
+	do {                               \
+		if (!rktest_require(#PROBE)) { \
+			return;                    \
+		}                              \
+	} while (0)
+
+#define RKTEST_SWEEP_MAX_REPORTED_FAILURES 8
+
+#define RKTEST_CHECK_FOR_RANGE(domain, first, last, check, user_data, is_assert)                                                   \
+	do {                                                                                                                           \
+		uint32_t failing_inputs[RKTEST_SWEEP_MAX_REPORTED_FAILURES];                                                               \
+		size_t num_failing_inputs = 0;                                                                                             \
+		const uint64_t num_failed = rktest_sweep(domain, first, last, check, user_data, failing_inputs, &num_failing_inputs);      \
+		if (num_failed > 0) {                                                                                                      \
+			if (rktest_filenames_enabled()) {                                                                                      \
+				printf("%s(%d): ", __FILE__, __LINE__);                                                                            \
+			}                                                                                                                      \
+			printf("error: `%s` failed for some inputs:\n", #check);                                                               \
+			rktest_print_sweep_failure(domain, first, last, num_failed, failing_inputs, num_failing_inputs);                       \
+			rktest_fail_current_test();                                                                                            \
+			if (is_assert) {                                                                                                       \
+				return;                                                                                                            \
+			}                                                                                                                      \
+		}                                                                                                                          \
+	} while (0)
+
+#define RKTEST_CHECK_P_VALUE(p_value_expr, sample, distribution, is_assert)                 \
+	do {                                                                                  \
+		const double p_value = p_value_expr;                                              \
+		const double threshold = rktest_p_value_threshold();                              \
+		if (p_value < threshold) {                                                        \
+			if (rktest_filenames_enabled()) {                                             \
+				printf("%s(%d): ", __FILE__, __LINE__);                                   \
+			}                                                                             \
+			printf("error: Samples of `%s` do not fit %s\n", #sample, distribution);      \
+			printf("  p-value: %g\n", p_value);                                           \
+			printf("Threshold: %g\n", threshold);                                         \
+			rktest_fail_current_test();                                                   \
+			if (is_assert) {                                                              \
+				return;                                                                   \
+			}                                                                             \
+		}                                                                                 \
+	} while (0)
 
 #define RKTEST_CHECK_BOOL(actual, expected, is_assert, ...)            \
 	do {                                                               \
@@ -560,13 +1518,86 @@ bool rktest_filenames_enabled(void);
 #include <string.h>
 
 #ifdef _MSC_VER
+#include <intrin.h>
 #include <windows.h>
-#elif defined(__MACH__)
-#include <mach/mach_time.h>
 #else
 #include <time.h>
 #endif
 
+#ifdef __MACH__
+#include <mach/mach_time.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <link.h>
+#include <linux/perf_event.h>
+#include <sys/auxv.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef _WIN32
+#define RKTEST_BENCHMARK_ISOLATION_SUPPORTED 1
+#define RKTEST_JOBS_SUPPORTED 1
+#include <sys/wait.h>
+#endif
+
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
+
+#ifdef _MSC_VER
+#include <direct.h>
+#include <process.h>
+#include <sys/stat.h>
+#define rktest_getpid _getpid
+#define rktest_mkdir(path) _mkdir(path)
+#define rktest_ftell _ftelli64
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define rktest_getpid getpid
+#define rktest_mkdir(path) mkdir(path, 0777)
+#define rktest_ftell ftello
+#endif
+
+#if defined(RKTEST_INTERPOSE_MALLOC) && defined(__GLIBC__)
+#define RKTEST_OOM_SWEEP_SUPPORTED 1
+#include <errno.h>
+#endif
+
+#ifdef _MSC_VER
+#include <io.h>
+#define rktest_dup _dup
+#define rktest_dup2 _dup2
+#define rktest_close _close
+#define rktest_lseek _lseek
+#define rktest_read _read
+#define rktest_fileno _fileno
+#define rktest_isatty _isatty
+#define rktest_access _access
+#define RKTEST_W_OK 2
+#else
+#include <unistd.h>
+#define rktest_dup dup
+#define rktest_dup2 dup2
+#define rktest_close close
+#define rktest_lseek lseek
+#define rktest_read read
+#define rktest_fileno fileno
+#define rktest_isatty isatty
+#define rktest_access access
+#define RKTEST_W_OK W_OK
+#endif
+
+#ifdef _MSC_VER
+#define RKTEST_THREAD_LOCAL __declspec(thread)
+#else
+#define RKTEST_THREAD_LOCAL __thread
+#endif
+
 #ifdef __GNUC__
 #pragma GCC diagnostic ignored "-Wmissing-braces"
 #endif
@@ -693,13 +1724,69 @@ rktest_millis_t rktest_timer_stop(rktest_timer_t* timer) {
 	clock_gettime(CLOCK_REALTIME, &timer->end);
 	rktest_millis_t ms = 0;
 	ms += (rktest_millis_t)((timer->end.tv_sec - timer->start.tv_sec) * 1000.0); // seconds
-	ms += (rktest_millis_t)((timer->end.tv_nsec - timer->start.tv_nsec) / 1000.0); // milliseconds
+	ms += (rktest_millis_t)((timer->end.tv_nsec - timer->start.tv_nsec) / 1000000.0); // milliseconds
 	return ms;
 }
 #endif
 
+// Monotonic clock with nanosecond resolution, used where millisecond timers are
+// too coarse, e.g. when timing thousands of short tests.
+typedef uint64_t rktest_nanos_t;
+
+#if defined(WIN32)
+rktest_nanos_t rktest_clock_nanos(void) {
+	LARGE_INTEGER freq;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+	return (rktest_nanos_t)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+}
+#elif defined(__MACH__)
+rktest_nanos_t rktest_clock_nanos(void) {
+	static mach_timebase_info_data_t timebase_info;
+	if (timebase_info.denom == 0) {
+		mach_timebase_info(&timebase_info);
+	}
+	return mach_absolute_time() * timebase_info.numer / timebase_info.denom;
+}
+#else
+rktest_nanos_t rktest_clock_nanos(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (rktest_nanos_t)now.tv_sec * 1000000000 + (rktest_nanos_t)now.tv_nsec;
+}
+#endif
+
 /* -------------------------- Types and constants -------------------------- */
 #define RKTEST_MAX_FILTER_LENGTH 256
+#define RKTEST_MAX_PATH_LENGTH 512
+#define RKTEST_MAX_TEST_NAME_LENGTH 256
+#define RKTEST_PROGRESS_REDRAW_INTERVAL_NS (100 * 1000 * 1000)
+#define RKTEST_PROGRESS_LINE_WIDTH 79
+#define RKTEST_DEFAULT_BENCHMARK_MIN_TIME_S 0.5
+#define RKTEST_ALIGNMENT_SWEEP_NUM_OFFSETS 64
+#define RKTEST_ALIGNMENT_SWEEP_SLOW_THRESHOLD 1.1 // p50 relative to the best offset
+#define RKTEST_BENCH_BUFFER_ALIGNMENT 4096
+#define RKTEST_DEFAULT_HUGE_PAGE_SIZE (2u << 20)
+#define RKTEST_MPOL_BIND 2 // from <linux/mempolicy.h>
+#define RKTEST_SWEEP_CHUNK_SIZE (1u << 16) // inputs taken at a time by a sweep thread
+#define RKTEST_SAMPLE_BATCH_SIZE 1024 // samples per call of a rktest_sample_fn
+#define RKTEST_SAMPLE_CHUNK_SIZE (1u << 16) // samples taken at a time by a sampling thread
+#define RKTEST_KOLMOGOROV_SMIRNOV_NUM_BINS (1u << 16)
+#define RKTEST_DEFAULT_P_VALUE_THRESHOLD 0.001
+#define RKTEST_CACHE_DATA_OFFSET 64 // cached data follows the header, aligned
+#define RKTEST_PERF_MAX_COUNTERS 3
+#define RKTEST_DEFAULT_PERF_THRESHOLD_PERCENT 1.0
+#define RKTEST_PREREQUISITE_TIMEOUT_S 600 // for prerequisites run by other workers
+#define RKTEST_RATE_SWEEP_MAX_STEPS 16
+#define RKTEST_RATE_SWEEP_MIN_THROUGHPUT 0.9 // of the target rate
+#define RKTEST_RATE_SWEEP_MAX_P99_GROWTH 10.0 // relative to the lowest rate
+
+// Values below 2 * RKTEST_HISTOGRAM_SUB_BUCKETS get one bucket each, and each
+// power of two above that is split into RKTEST_HISTOGRAM_SUB_BUCKETS buckets.
+#define RKTEST_HISTOGRAM_SUB_BUCKET_BITS 6
+#define RKTEST_HISTOGRAM_SUB_BUCKETS (1 << RKTEST_HISTOGRAM_SUB_BUCKET_BITS)
+#define RKTEST_HISTOGRAM_NUM_BUCKETS ((64 - RKTEST_HISTOGRAM_SUB_BUCKET_BITS + 1) * RKTEST_HISTOGRAM_SUB_BUCKETS)
 
 typedef enum {
 	RKTEST_ENABLE_VTERM_ERROR_INVALID_HANDLE_VALUE,
@@ -714,18 +1801,65 @@ typedef enum {
 	RKTEST_COLOR_MODE_AUTO,
 } rktest_color_mode_t;
 
-typedef struct {
+typedef enum {
+	RKTEST_LEAK_CHECK_OFF,
+	RKTEST_LEAK_CHECK_REPORT,
+	RKTEST_LEAK_CHECK_FAIL,
+} rktest_leak_check_mode_t;
+
+typedef enum {
+	RKTEST_PERF_COUNTERS_OFF,
+	RKTEST_PERF_COUNTERS_INSTRUCTIONS,
+	RKTEST_PERF_COUNTERS_CACHES,
+} rktest_perf_counters_mode_t;
+
+typedef enum {
+	RKTEST_BENCHMARK_ISOLATION_NONE,
+	RKTEST_BENCHMARK_ISOLATION_PROCESS,
+} rktest_benchmark_isolation_t;
+
+typedef struct {
 	rktest_color_mode_t color_mode;
 	char test_filter[RKTEST_MAX_FILTER_LENGTH];
 	bool print_timestamps_enabled;
+	rktest_leak_check_mode_t leak_check_mode;
+	bool progress_enabled;
+	rktest_perf_counters_mode_t perf_counters_mode;
+	char perf_save_path[RKTEST_MAX_PATH_LENGTH];
+	char perf_baseline_path[RKTEST_MAX_PATH_LENGTH];
+	double perf_threshold_percent;
+	char oom_sweep_filter[RKTEST_MAX_FILTER_LENGTH];
+	rktest_isa_t isa_max;
+	size_t jobs; // worker processes running the test suites
+	bool pipeline_fixtures_enabled;
+	size_t shards; // instances of each TEST_DATA() and TEST_INDEXED()
+	char benchmark_filter[RKTEST_MAX_FILTER_LENGTH];
+	double benchmark_min_time_s;
+	size_t benchmark_repetitions;
+	rktest_benchmark_isolation_t benchmark_isolation;
+	size_t benchmark_alignment_stride; // zero if not sweeping
+	bool benchmark_rate_sweep_enabled;
+	char benchmark_json_path[RKTEST_MAX_PATH_LENGTH];
 } rktest_config_t;
 
+// Outcome of a SUITE_SETUP(), SUITE_TEARDOWN() or SHARED_SETUP()
+typedef struct {
+	bool failed;
+	bool skipped;
+} rktest_fixture_status_t;
+
 typedef struct {
 	const char* name;
 	vec_t(rktest_test_t) tests;
 	size_t num_disabled_tests;
 	void (*setup)(void);
 	void (*teardown)(void);
+	void (*shared_setup)(void); // of SHARED_SETUP(), run once before all tests
+	rktest_fixture_status_t shared_setup_status;
+	void (*suite_setup)(void);
+	void (*suite_teardown)(void);
+	bool is_setup_independent;
+	bool is_teardown_independent;
 } rktest_suite_t;
 
 typedef struct {
@@ -733,18 +1867,188 @@ typedef struct {
 	size_t total_num_filtered_suites;
 	size_t total_num_filtered_tests;
 	size_t total_num_disabled_tests;
+	vec_t(rktest_test_t) benchmarks;
+	vec_t(rktest_test_t) benchmark_fixtures; // BENCHMARK_SETUP() and BENCHMARK_TEARDOWN()
+	vec_t(char*) instance_names; // names of TEST_ISA() instances and of shards
+	void (*isa_hook)(rktest_isa_t isa);
+	rktest_isa_t native_isa; // highest level supported by the machine
 } rktest_environment_t;
 
 typedef struct {
 	size_t num_passed_tests;
 	vec_t(rktest_test_t) failed_tests;
+	vec_t(rktest_test_t) skipped_tests; // by RKTEST_SKIP() or a failed prerequisite
 } rktest_report_t;
 
+// Duration of a test from a previous run, used for estimating time left
+typedef struct {
+	char* full_test_name;
+	uint64_t duration_us;
+} rktest_duration_entry_t;
+
+// State of the status line printed with `--rktest_progress`
+typedef struct {
+	vec_t(rktest_duration_entry_t) history; // sorted by name
+	vec_t(rktest_duration_entry_t) new_entries; // tests missing from history
+	size_t num_tests;
+	size_t num_done;
+	size_t num_failed;
+	uint64_t remaining_known_us; // historical duration of tests not yet run
+	size_t remaining_unknown; // tests not yet run without a historical duration
+	rktest_nanos_t start_ns;
+	rktest_nanos_t test_start_ns;
+	rktest_nanos_t last_redraw_ns;
+	FILE* capture_file; // receives stdout while a test runs
+	int saved_stdout_fd;
+} rktest_progress_t;
+
+// HDR style histogram with log-linear buckets, giving a bounded relative error
+// with a fixed amount of memory and constant time recording.
+typedef struct {
+	uint64_t* counts;
+	uint64_t total_count;
+	uint64_t min;
+	uint64_t max;
+	double sum;
+} rktest_histogram_t;
+
+// Memory from rktest_bench_alloc()
+typedef struct {
+	char* address;
+	size_t size;
+	size_t mapping_size; // zero if allocated with malloc()
+	size_t page_size;
+	bool is_hugetlb;
+} rktest_bench_allocation_t;
+
+struct rktest_bench {
+	rktest_histogram_t histogram; // nanoseconds per iteration
+	rktest_nanos_t min_time_ns;
+	rktest_nanos_t start_ns;
+	rktest_nanos_t last_ns; // for rate benchmarks, the scheduled start
+	rktest_nanos_t end_ns;
+	rktest_nanos_t pause_start_ns;
+	rktest_nanos_t paused_ns; // since last_ns, excluded from the timing
+	uint64_t num_iterations;
+	size_t batch_size;
+	size_t batch_remaining;
+	double ops_per_sec;
+	int64_t arg;
+	size_t alignment_offset;
+	vec_t(void*) buffers; // from rktest_bench_buffer()
+	size_t num_buffers;
+	vec_t(rktest_bench_allocation_t) allocations; // from rktest_bench_alloc()
+	uint64_t allocated_bytes;
+	uint64_t huge_page_bytes; // of allocated_bytes
+	size_t huge_page_size;
+	uint64_t perf_counts[RKTEST_PERF_MAX_COUNTERS]; // over the timed iterations
+	bool is_running;
+	bool is_paused;
+	bool is_batch_timed; // between rktest_bench_batch_start() and the next setup
+	bool is_failed;
+};
+
+// Instruction and cache miss counts of a test, or of a benchmark iteration
+typedef struct {
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	uint64_t counts[RKTEST_PERF_MAX_COUNTERS];
+} rktest_perf_entry_t;
+
+typedef struct {
+	int fds[RKTEST_PERF_MAX_COUNTERS];
+	size_t num_counters;
+	size_t num_regressions;
+	bool is_available;
+	vec_t(rktest_perf_entry_t) baseline;
+	vec_t(rktest_perf_entry_t) results;
+} rktest_perf_t;
+
+// What a single run of a benchmark body is parameterized with
+typedef struct {
+	int64_t arg;
+	double ops_per_sec;
+	size_t alignment_offset;
+} rktest_bench_params_t;
+
+// Where benchmark results are written with `--rktest_benchmark_json`
+typedef struct {
+	FILE* file;
+	size_t num_entries;
+} rktest_benchmark_json_t;
+
+// The BENCHMARK_SETUP() that currently holds, which is only torn down when a
+// benchmark needs another suite or argument
+typedef struct {
+	const char* suite_name;
+	void (*teardown)(int64_t arg);
+	int64_t arg;
+	bool is_set_up;
+} rktest_bench_fixture_t;
+
+// Outcome of a child process where one allocation was made to fail
+typedef struct {
+	size_t allocation_index;
+	int wait_status;
+} rktest_oom_result_t;
+
+// State of the allocation failure sweep of `--rktest_oom_sweep`
+typedef struct {
+	bool is_child; // in a child process where one allocation has failed
+	bool in_hook; // allocations made by the sweep itself pass through
+	size_t num_allocations;
+	long net_allocations; // allocations minus frees since setup
+	vec_t(rktest_oom_result_t) results;
+} rktest_oom_sweep_t;
+
+// Capability probe of RKTEST_PROBE(), run the first time a test requires it
+typedef struct {
+	const char* name;
+	bool (*probe)(void);
+	bool is_probed;
+	bool is_available;
+} rktest_probe_t;
+
+// Header of a file cached by rktest_cached_data()
+typedef struct {
+	char magic[8];
+	uint64_t build_id; // hash of the build of the test program
+	uint64_t key_hash;
+	uint64_t data_size;
+	uint32_t version;
+} rktest_cache_header_t;
+
+// Data returned by rktest_cached_data() in this run
+typedef struct {
+	char* key;
+	uint32_t version;
+	const void* data;
+	size_t size;
+	void* mapping; // mapped cache file, or NULL if `data` is allocated
+	size_t mapping_size;
+} rktest_cached_data_t;
+
+// Open file descriptors and running threads of the process at some point in time
+typedef struct {
+	vec_t(int) fds;
+	vec_t(int) threads;
+} rktest_resource_snapshot_t;
+
 /* ---------------------------- String utility ----------------------------- */
 static bool string_starts_with(const char* str, const char* prefix) {
 	return strncmp(prefix, str, strlen(prefix)) == 0;
 }
 
+static void format_full_test_name(char* buf, size_t buf_size, const rktest_test_t* test) {
+	snprintf(buf, buf_size, "%s.%s", test->suite_name, test->test_name);
+}
+
+static char* string_duplicate(const char* str) {
+	const size_t size = strlen(str) + 1;
+	char* copy = malloc(size);
+	memcpy(copy, str, size);
+	return copy;
+}
+
 // Based on "EnhancedMaskTest" function in 7zip source code
 // https://github.com/mcmilk/7-Zip/blob/master/CPP/Common/Wildcard.cpp
 static bool string_wildcard_match(const char* str, const char* pattern) {
@@ -802,7 +2106,28 @@ __attribute__((used, section("rktest"))) const rktest_test_t* const dummy = NULL
 /* -------------------- Header function implementations -------------------- */
 static bool g_colors_enabled = false;
 static bool g_current_test_failed = false;
+static bool g_current_test_skipped = false;
+static RKTEST_THREAD_LOCAL rktest_fixture_status_t* g_fixture_status = NULL; // of the suite fixture running on this thread
+static vec_t(rktest_probe_t) g_probes = vec_new();
 static bool g_filenames_enabled = true;
+static double g_p_value_threshold = RKTEST_DEFAULT_P_VALUE_THRESHOLD;
+static char g_cache_dir[RKTEST_MAX_PATH_LENGTH]; // of --rktest_cache_dir, resolved by get_cache_dir()
+static char g_data_dir[RKTEST_MAX_PATH_LENGTH]; // of --rktest_data_dir
+static char g_executable_path[RKTEST_MAX_PATH_LENGTH];
+
+// The allocation failure sweep only counts and fails allocations of the thread
+// running the test, and not those of RK Test functions called by the test
+static RKTEST_THREAD_LOCAL bool g_oom_sweep_is_counting = false; // between setup and teardown
+static RKTEST_THREAD_LOCAL bool g_oom_sweep_is_injecting = false; // in the test body
+static RKTEST_THREAD_LOCAL int g_oom_sweep_num_suspensions = 0;
+
+static void suspend_oom_sweep(void) {
+	g_oom_sweep_num_suspensions++;
+}
+
+static void resume_oom_sweep(void) {
+	g_oom_sweep_num_suspensions--;
+}
 
 bool rktest_colors_enabled(void) {
 	return g_colors_enabled;
@@ -813,9 +2138,49 @@ bool rktest_filenames_enabled(void) {
 }
 
 void rktest_fail_current_test(void) {
+	if (g_fixture_status) {
+		g_fixture_status->failed = true;
+		return;
+	}
 	g_current_test_failed = true;
 }
 
+void rktest_skip_current_test(const char* reason) {
+	bool* skipped = g_fixture_status ? &g_fixture_status->skipped : &g_current_test_skipped;
+	if (!*skipped) {
+		printf("Skipped: %s\n", reason);
+	}
+	*skipped = true;
+}
+
+static bool require_probe(const char* probe_name) {
+	vec_foreach(rktest_probe_t*, probe, g_probes) {
+		if (strcmp(probe->name, probe_name) != 0) {
+			continue;
+		}
+		if (!probe->is_probed) {
+			probe->is_available = probe->probe();
+			probe->is_probed = true;
+		}
+		if (!probe->is_available) {
+			char reason[RKTEST_MAX_TEST_NAME_LENGTH];
+			snprintf(reason, sizeof(reason), "requires %s", probe_name);
+			rktest_skip_current_test(reason);
+		}
+		return probe->is_available;
+	}
+	printf("error: No probe named %s, define it with RKTEST_PROBE(%s)\n", probe_name, probe_name);
+	rktest_fail_current_test();
+	return false;
+}
+
+bool rktest_require(const char* probe_name) {
+	suspend_oom_sweep();
+	const bool is_available = require_probe(probe_name);
+	resume_oom_sweep();
+	return is_available;
+}
+
 bool rktest_string_is_number(const char* str) {
 	for (int i = 0; str[i] != '\0'; i++) {
 		if (!isdigit(str[i])) {
@@ -870,300 +2235,4225 @@ bool rktest_doubles_within_4_ulp(double lhs, double rhs) {
 	return prev_4_ulp_double(rhs) <= lhs && lhs <= next_4_ulp_double(rhs);
 }
 
-/* ------------------------- RKTest implementation ------------------------- */
-static void print_usage(void) {
-	printf("\n");
-	printf("This program is a unit test runner built using RK Test.\n");
-	printf("\n");
-	printf("Usage:\n");
-	printf("\n");
-	printf("  --rktest_color=(yes|no|auto)\n");
-	printf("    Enable/disable colored output. The default is auto.\n");
-	printf("\n");
-	printf("  --rktest_filter=PATTERN\n");
-	printf("    Run only the tests that matches the globbing pattern. * matches against\n");
-	printf("    any number of characters, and ? matches any single character.\n");
-	printf("\n");
-	printf("  --rktest_print_time=0\n");
-	printf("    Disable printing out the elapsed time for test cases and test suites.\n");
-	printf("\n");
-	printf("  --rktest_print_filenames=0\n");
-	printf("    Disable printing out the filename of a test case on assert failure.\n");
+void rktest_do_not_optimize(const volatile void* ptr) {
+	(void)ptr;
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+#endif
 }
 
-static rktest_config_t parse_args(int argc, const char* argv[]) {
-	rktest_config_t config = (rktest_config_t) { 0 };
-	config.color_mode = RKTEST_COLOR_MODE_AUTO;
-	config.print_timestamps_enabled = true;
+/* -------------------------------- Threads -------------------------------- */
+#ifdef _MSC_VER
+typedef HANDLE rktest_thread_t;
+typedef CRITICAL_SECTION rktest_mutex_t;
+#define rktest_mutex_init(mutex) InitializeCriticalSection(mutex)
+#define rktest_mutex_destroy(mutex) DeleteCriticalSection(mutex)
+#define rktest_mutex_lock(mutex) EnterCriticalSection(mutex)
+#define rktest_mutex_unlock(mutex) LeaveCriticalSection(mutex)
+#else
+typedef pthread_t rktest_thread_t;
+typedef pthread_mutex_t rktest_mutex_t;
+#define rktest_mutex_init(mutex) pthread_mutex_init(mutex, NULL)
+#define rktest_mutex_destroy(mutex) pthread_mutex_destroy(mutex)
+#define rktest_mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define rktest_mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#endif
 
-	for (int i = 1; i < argc; i++) {
-		const char* arg = argv[i];
+static size_t num_online_cpus(void) {
+#ifdef _MSC_VER
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return num_cpus > 0 ? (size_t)num_cpus : 1;
+#endif
+}
 
-		if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
-			print_usage();
-			exit(1);
-		}
+typedef struct {
+	void (*thread_main)(void* arg);
+	void* arg;
+} rktest_thread_task_t;
 
-		else if (string_starts_with(arg, "--rktest_color=")) {
-			if (strcmp(arg + strlen("--rktest_color="), "yes") == 0) {
-				config.color_mode = RKTEST_COLOR_MODE_ON;
-			} else if (strcmp(arg + strlen("--rktest_color="), "no") == 0) {
-				config.color_mode = RKTEST_COLOR_MODE_OFF;
-			} else if (strcmp(arg + strlen("--rktest_color="), "auto") == 0) {
-				config.color_mode = RKTEST_COLOR_MODE_AUTO;
-			} else {
-				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
-				print_usage();
-				exit(1);
-			}
+#ifdef _MSC_VER
+static DWORD WINAPI run_thread_task(LPVOID task) {
+	((rktest_thread_task_t*)task)->thread_main(((rktest_thread_task_t*)task)->arg);
+	return 0;
+}
+#else
+static void* run_thread_task(void* task) {
+	((rktest_thread_task_t*)task)->thread_main(((rktest_thread_task_t*)task)->arg);
+	return NULL;
+}
+#endif
+
+// Starts running `task` on a new thread, returns false if none could be created
+static bool start_thread(rktest_thread_t* thread, rktest_thread_task_t* task) {
+#ifdef _MSC_VER
+	*thread = CreateThread(NULL, 0, run_thread_task, task, 0, NULL);
+	return *thread != NULL;
+#else
+	return pthread_create(thread, NULL, run_thread_task, task) == 0;
+#endif
+}
+
+static void join_thread(rktest_thread_t thread) {
+#ifdef _MSC_VER
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+}
+
+// Runs `thread_main(arg)` on `num_threads` threads, one of them being the
+// calling thread, and returns when all of them have returned.
+static void run_threads(size_t num_threads, void (*thread_main)(void* arg), void* arg) {
+	rktest_thread_task_t task = { thread_main, arg };
+	vec_t(rktest_thread_t) threads = vec_new();
+	for (size_t i = 1; i < num_threads; i++) {
+		rktest_thread_t thread;
+		if (start_thread(&thread, &task)) {
+			vec_push(threads, thread);
 		}
+	}
+	thread_main(arg);
+	vec_foreach(rktest_thread_t*, thread, threads) {
+		join_thread(*thread);
+	}
+	vec_free(threads);
+}
 
-		else if (string_starts_with(arg, "--rktest_filter=")) {
-			const char* filter_pattern = arg + strlen("--rktest_filter=");
-			const size_t filter_len = strlen(filter_pattern);
-			if (filter_len > RKTEST_MAX_FILTER_LENGTH) {
-				fprintf(stderr, "Error: filter pattern too long. Max length is (%d)", RKTEST_MAX_FILTER_LENGTH);
-				fprintf(stderr, "filter pattern = \"%s\"", filter_pattern);
-				exit(1);
-			}
-			strncpy(config.test_filter, filter_pattern, filter_len);
+/* --------------------------- Exhaustive sweeps --------------------------- */
+// State shared by the threads of a sweep, guarded by `mutex`
+typedef struct {
+	rktest_domain_t domain;
+	rktest_sweep_fn check;
+	void* user_data;
+	uint64_t next_input; // first input of the next chunk to check
+	uint64_t end_input;
+	uint64_t num_failed;
+	uint32_t failing_inputs[RKTEST_SWEEP_MAX_REPORTED_FAILURES]; // smallest failing inputs, sorted
+	size_t num_failing_inputs;
+	rktest_mutex_t mutex;
+} rktest_sweep_t;
+
+// Merges failing inputs of a chunk, in ascending order, into the smallest ones of the sweep
+static void merge_failing_inputs(rktest_sweep_t* sweep, const uint32_t* inputs, size_t num_inputs) {
+	uint32_t* smallest = sweep->failing_inputs;
+	for (size_t i = 0; i < num_inputs; i++) {
+		const bool is_full = sweep->num_failing_inputs == RKTEST_SWEEP_MAX_REPORTED_FAILURES;
+		if (is_full && inputs[i] >= smallest[RKTEST_SWEEP_MAX_REPORTED_FAILURES - 1]) {
+			return;
+		}
+		/* Insertion sort, dropping the largest input if full */
+		size_t pos = is_full ? RKTEST_SWEEP_MAX_REPORTED_FAILURES - 1 : sweep->num_failing_inputs++;
+		while (pos > 0 && smallest[pos - 1] > inputs[i]) {
+			smallest[pos] = smallest[pos - 1];
+			pos--;
 		}
+		smallest[pos] = inputs[i];
+	}
+}
 
-		else if (string_starts_with(arg, "--rktest_print_time=")) {
-			if (strcmp(arg + strlen("--rktest_print_time="), "0") == 0) {
-				config.print_timestamps_enabled = false;
-			} else {
-				config.print_timestamps_enabled = true;
-			}
+static void run_sweep_thread(void* arg) {
+	rktest_sweep_t* sweep = arg;
+	union {
+		uint16_t u16[RKTEST_SWEEP_BATCH_SIZE];
+		uint32_t u32[RKTEST_SWEEP_BATCH_SIZE]; // also bit patterns of floats
+	} inputs;
+	bool failed[RKTEST_SWEEP_BATCH_SIZE];
+
+	while (true) {
+		rktest_mutex_lock(&sweep->mutex);
+		const uint64_t chunk_begin = sweep->next_input;
+		const uint64_t chunk_end = sweep->end_input - chunk_begin < RKTEST_SWEEP_CHUNK_SIZE ? sweep->end_input : chunk_begin + RKTEST_SWEEP_CHUNK_SIZE;
+		sweep->next_input = chunk_end;
+		rktest_mutex_unlock(&sweep->mutex);
+		if (chunk_begin == chunk_end) {
+			return;
 		}
 
-		else if (string_starts_with(arg, "--rktest_print_filenames=")) {
-			if (strcmp(arg + strlen("--rktest_print_filenames="), "0") == 0) {
-				g_filenames_enabled = false;
-			} else {
-				g_filenames_enabled = true;
+		uint64_t num_failed = 0;
+		uint32_t failing_inputs[RKTEST_SWEEP_MAX_REPORTED_FAILURES];
+		size_t num_failing_inputs = 0;
+		for (uint64_t batch_begin = chunk_begin; batch_begin < chunk_end; batch_begin += RKTEST_SWEEP_BATCH_SIZE) {
+			const size_t count = chunk_end - batch_begin < RKTEST_SWEEP_BATCH_SIZE ? (size_t)(chunk_end - batch_begin) : RKTEST_SWEEP_BATCH_SIZE;
+			for (size_t i = 0; i < count; i++) {
+				const uint32_t input = (uint32_t)(batch_begin + i);
+				if (sweep->domain == RKTEST_DOMAIN_UINT16) {
+					inputs.u16[i] = (uint16_t)input;
+				} else {
+					inputs.u32[i] = input;
+				}
+			}
+			memset(failed, 0, count * sizeof(bool));
+			sweep->check(&inputs, failed, count, sweep->user_data);
+			for (size_t i = 0; i < count; i++) {
+				if (!failed[i]) {
+					continue;
+				}
+				num_failed++;
+				if (num_failing_inputs < RKTEST_SWEEP_MAX_REPORTED_FAILURES) {
+					failing_inputs[num_failing_inputs++] = (uint32_t)(batch_begin + i);
+				}
 			}
 		}
 
-		else {
-			fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
-			print_usage();
-			exit(1);
+		if (num_failed > 0) {
+			rktest_mutex_lock(&sweep->mutex);
+			sweep->num_failed += num_failed;
+			merge_failing_inputs(sweep, failing_inputs, num_failing_inputs);
+			rktest_mutex_unlock(&sweep->mutex);
 		}
 	}
+}
+
+// Checks the inputs `first` to `last` of `domain` on all cores, and returns
+// the number of failing inputs. The smallest failing inputs are written to
+// `failing_inputs`, which has room for RKTEST_SWEEP_MAX_REPORTED_FAILURES.
+static uint64_t run_sweep(rktest_domain_t domain, uint32_t first, uint32_t last, rktest_sweep_fn check, void* user_data, uint32_t* failing_inputs, size_t* num_failing_inputs) {
+	*num_failing_inputs = 0;
+	if (last < first) {
+		return 0;
+	}
 
-	return config;
+	rktest_sweep_t sweep = { 0 };
+	sweep.domain = domain;
+	sweep.check = check;
+	sweep.user_data = user_data;
+	sweep.next_input = first;
+	sweep.end_input = (uint64_t)last + 1;
+	rktest_mutex_init(&sweep.mutex);
+
+	const uint64_t num_chunks = (sweep.end_input - sweep.next_input + RKTEST_SWEEP_CHUNK_SIZE - 1) / RKTEST_SWEEP_CHUNK_SIZE;
+	const size_t num_cpus = num_online_cpus();
+	run_threads(num_chunks < num_cpus ? (size_t)num_chunks : num_cpus, run_sweep_thread, &sweep);
+	rktest_mutex_destroy(&sweep.mutex);
+
+	memcpy(failing_inputs, sweep.failing_inputs, sweep.num_failing_inputs * sizeof(uint32_t));
+	*num_failing_inputs = sweep.num_failing_inputs;
+	return sweep.num_failed;
 }
 
-#ifdef _MSC_VER
-static rktest_enable_vterm_result_t enable_windows_virtual_terminal(void) {
-	// Set output mode to handle virtual terminal sequences
-	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-	if (hOut == INVALID_HANDLE_VALUE) {
-		return RKTEST_ENABLE_VTERM_ERROR_INVALID_HANDLE_VALUE;
+uint64_t rktest_sweep(rktest_domain_t domain, uint32_t first, uint32_t last, rktest_sweep_fn check, void* user_data, uint32_t* failing_inputs, size_t* num_failing_inputs) {
+	suspend_oom_sweep();
+	const uint64_t result = run_sweep(domain, first, last, check, user_data, failing_inputs, num_failing_inputs);
+	resume_oom_sweep();
+	return result;
+}
+
+void rktest_print_sweep_failure(rktest_domain_t domain, uint32_t first, uint32_t last, uint64_t num_failed, const uint32_t* failing_inputs, size_t num_failing_inputs) {
+	const uint64_t num_inputs = (uint64_t)last - first + 1;
+	printf("  Failed for %llu of %llu inputs, the smallest being:\n", (unsigned long long)num_failed, (unsigned long long)num_inputs);
+	for (size_t i = 0; i < num_failing_inputs; i++) {
+		if (domain == RKTEST_DOMAIN_FLOAT32) {
+			float value;
+			memcpy(&value, &failing_inputs[i], sizeof(value));
+			printf("    %.9g (0x%08lx)\n", value, (unsigned long)failing_inputs[i]);
+		} else {
+			printf("    %lu\n", (unsigned long)failing_inputs[i]);
+		}
 	}
+}
 
-	DWORD dwMode = 0;
-	if (!GetConsoleMode(hOut, &dwMode)) {
-		return RKTEST_ENABLE_VTERM_ERROR_GET_CONSOLE_MODE_FAILED;
+/* ------------------------- Statistical assertions ------------------------- */
+// State shared by the threads drawing samples, guarded by `mutex`
+typedef struct {
+	rktest_sample_fn sample;
+	void* user_data;
+	rktest_cdf_fn cdf; // bins samples by their CDF if set, else by their value
+	void* cdf_user_data;
+	size_t num_bins;
+	uint64_t next_sample; // first sample of the next chunk to draw
+	uint64_t num_samples;
+	uint64_t* counts; // per bin, followed by the count of samples outside all bins
+	rktest_mutex_t mutex;
+} rktest_sampling_t;
+
+static uint64_t splitmix64(uint64_t x) {
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+static void run_sampling_thread(void* arg) {
+	rktest_sampling_t* sampling = arg;
+	double samples[RKTEST_SAMPLE_BATCH_SIZE];
+	uint64_t* counts = calloc(sampling->num_bins + 1, sizeof(uint64_t));
+
+	while (true) {
+		rktest_mutex_lock(&sampling->mutex);
+		const uint64_t chunk_begin = sampling->next_sample;
+		const uint64_t chunk_end = sampling->num_samples - chunk_begin < RKTEST_SAMPLE_CHUNK_SIZE ? sampling->num_samples : chunk_begin + RKTEST_SAMPLE_CHUNK_SIZE;
+		sampling->next_sample = chunk_end;
+		rktest_mutex_unlock(&sampling->mutex);
+		if (chunk_begin == chunk_end) {
+			break;
+		}
+
+		/* Batches are seeded by their position, so samples do not depend on the threads */
+		for (uint64_t batch_begin = chunk_begin; batch_begin < chunk_end; batch_begin += RKTEST_SAMPLE_BATCH_SIZE) {
+			const size_t count = chunk_end - batch_begin < RKTEST_SAMPLE_BATCH_SIZE ? (size_t)(chunk_end - batch_begin) : RKTEST_SAMPLE_BATCH_SIZE;
+			sampling->sample(samples, count, splitmix64(batch_begin / RKTEST_SAMPLE_BATCH_SIZE), sampling->user_data);
+			for (size_t i = 0; i < count; i++) {
+				double bin = samples[i];
+				if (sampling->cdf) {
+					bin = sampling->cdf(samples[i], sampling->cdf_user_data) * (double)sampling->num_bins;
+					bin = bin < (double)sampling->num_bins ? bin : (double)sampling->num_bins - 1;
+				}
+				const bool is_in_bins = bin >= 0.0 && bin < (double)sampling->num_bins; // false for nan
+				counts[is_in_bins ? (size_t)bin : sampling->num_bins]++;
+			}
+		}
 	}
 
-	dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-	if (!SetConsoleMode(hOut, dwMode)) {
-		return RKTEST_ENABLE_VTERM_ERROR_ENABLE_VIRTUAL_TERMINAL_FAILED;
+	rktest_mutex_lock(&sampling->mutex);
+	for (size_t i = 0; i <= sampling->num_bins; i++) {
+		sampling->counts[i] += counts[i];
 	}
+	rktest_mutex_unlock(&sampling->mutex);
+	free(counts);
+}
 
-	return RKTEST_ENABLE_VTERM_OK;
+// Draws `sampling.num_samples` samples on all cores and counts them per bin
+static void draw_samples(rktest_sampling_t* sampling) {
+	sampling->counts = calloc(sampling->num_bins + 1, sizeof(uint64_t));
+	rktest_mutex_init(&sampling->mutex);
+	const uint64_t num_chunks = (sampling->num_samples + RKTEST_SAMPLE_CHUNK_SIZE - 1) / RKTEST_SAMPLE_CHUNK_SIZE;
+	const size_t num_cpus = num_online_cpus();
+	run_threads(num_chunks < num_cpus ? (size_t)num_chunks : num_cpus, run_sampling_thread, sampling);
+	rktest_mutex_destroy(&sampling->mutex);
 }
-#endif // WIN32
 
-static rktest_config_t initialize(int argc, const char* argv[]) {
-	rktest_config_t config = parse_args(argc, argv);
+static double log_gamma_prefix(double a, double x) {
+	return -x + a * log(x) - lgamma(a);
+}
 
-	g_colors_enabled = true;
-	if (config.color_mode == RKTEST_COLOR_MODE_OFF) {
-		g_colors_enabled = false;
+// Regularized upper incomplete gamma function Q(a, x), computed with a series
+// or a continued fraction as in Numerical Recipes
+static double regularized_gamma_q(double a, double x) {
+	if (x <= 0.0) {
+		return 1.0;
 	}
-
-#ifdef _MSC_VER
-	if (g_colors_enabled) {
-		switch (enable_windows_virtual_terminal()) {
-			case RKTEST_ENABLE_VTERM_ERROR_INVALID_HANDLE_VALUE:
-				g_colors_enabled = false;
-				fprintf(stderr, "Error: GetStdHandle returned INVALID_HANDLE_VALUE\n");
-				break;
-			case RKTEST_ENABLE_VTERM_ERROR_GET_CONSOLE_MODE_FAILED:
-				g_colors_enabled = false;
-				break;
-			case RKTEST_ENABLE_VTERM_ERROR_ENABLE_VIRTUAL_TERMINAL_FAILED:
-				g_colors_enabled = false;
-				fprintf(stderr, "Error: SetConsoleMode to ENABLE_VIRTUAL_TERMINAL_PROCESSING failed\n");
-				break;
-			case RKTEST_ENABLE_VTERM_OK:
-				break;
+	if (x < a + 1.0) {
+		double term = 1.0 / a;
+		double sum = term;
+		for (int n = 1; n < 10000 && fabs(term) > fabs(sum) * DBL_EPSILON; n++) {
+			term *= x / (a + n);
+			sum += term;
 		}
+		return 1.0 - sum * exp(log_gamma_prefix(a, x));
 	}
-#endif // WIN32
-
-	return config;
+	const double tiny = DBL_MIN / DBL_EPSILON;
+	double b = x + 1.0 - a;
+	double c = 1.0 / tiny;
+	double d = 1.0 / b;
+	double h = d;
+	for (int i = 1; i < 10000; i++) {
+		const double an = -i * (i - a);
+		b += 2.0;
+		d = an * d + b;
+		d = fabs(d) < tiny ? tiny : d;
+		c = b + an / c;
+		c = fabs(c) < tiny ? tiny : c;
+		d = 1.0 / d;
+		h *= d * c;
+		if (fabs(d * c - 1.0) < DBL_EPSILON) {
+			break;
+		}
+	}
+	return exp(log_gamma_prefix(a, x)) * h;
 }
 
-static rktest_suite_t* find_suite_with_name(vec_t(rktest_suite_t) suites, const char* suite_name) {
-	vec_foreach(rktest_suite_t*, suite, suites) {
-		if (strcmp(suite->name, suite_name) == 0) {
-			return suite;
+// Probability that the Kolmogorov distribution exceeds `lambda`
+static double kolmogorov_q(double lambda) {
+	double sum = 0.0;
+	double sign = 2.0;
+	double previous_term = 0.0;
+	for (int j = 1; j <= 100; j++) {
+		const double term = sign * exp(-2.0 * j * j * lambda * lambda);
+		sum += term;
+		if (fabs(term) <= 0.001 * previous_term || fabs(term) <= 1e-8 * sum) {
+			return sum;
 		}
+		sign = -sign;
+		previous_term = fabs(term);
 	}
-	return NULL;
+	return 1.0; // only fails to converge for tiny lambda
 }
 
-static bool test_matches_filter(const rktest_test_t* test, const char* pattern) {
-	if (*pattern == '\0') {
-		return true;
+// Returns the p-value of a chi-square test of the bucket indices drawn by
+// `sample` against `probabilities`, or equal probabilities if NULL. Samples
+// outside of the buckets give a p-value of zero.
+static double chi_square_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, const double* probabilities, size_t num_buckets) {
+	rktest_sampling_t sampling = { 0 };
+	sampling.sample = sample;
+	sampling.user_data = user_data;
+	sampling.num_bins = num_buckets;
+	sampling.num_samples = num_samples;
+	draw_samples(&sampling);
+
+	double chi_square = 0.0;
+	size_t degrees_of_freedom = 0;
+	bool is_impossible = sampling.counts[num_buckets] > 0;
+	for (size_t i = 0; i < num_buckets; i++) {
+		const double expected = (double)num_samples * (probabilities ? probabilities[i] : 1.0 / (double)num_buckets);
+		const double observed = (double)sampling.counts[i];
+		if (expected <= 0.0) {
+			is_impossible |= observed > 0.0;
+			continue;
+		}
+		chi_square += (observed - expected) * (observed - expected) / expected;
+		degrees_of_freedom++;
 	}
+	free(sampling.counts);
 
-	char full_test_name[128];
-	snprintf(full_test_name, sizeof(full_test_name) / sizeof(char), "%s.%s", test->suite_name, test->test_name);
-	return string_wildcard_match(full_test_name, pattern);
+	if (is_impossible) {
+		return 0.0;
+	}
+	if (degrees_of_freedom < 2) {
+		return 1.0;
+	}
+	return regularized_gamma_q((double)(degrees_of_freedom - 1) / 2.0, chi_square / 2.0);
 }
 
-// Loop through the entirety of the `rkdata` memory section, including padding.
-// If the iterator `it` points to null, it's padding and we skip it.
-// If it's non-null, we have a test and push it into `tests`.
-static rktest_environment_t setup_test_env(const rktest_config_t* config) {
-	rktest_environment_t env = { 0 };
+double rktest_chi_square_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, const double* probabilities, size_t num_buckets) {
+	suspend_oom_sweep();
+	const double result = chi_square_p_value(sample, user_data, num_samples, probabilities, num_buckets);
+	resume_oom_sweep();
+	return result;
+}
 
-	for (const rktest_test_t* const* it = TEST_DATA_BEGIN; it != TEST_DATA_END; it++) {
-		if (*it == NULL) {
-			continue;
-		}
+// Returns the p-value of a Kolmogorov-Smirnov test of the samples drawn by
+// `sample` against the distribution function `cdf`. Samples are binned by
+// their CDF, so the test statistic is exact to within 1 / 65536.
+static double kolmogorov_smirnov_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, rktest_cdf_fn cdf, void* cdf_user_data) {
+	rktest_sampling_t sampling = { 0 };
+	sampling.sample = sample;
+	sampling.user_data = user_data;
+	sampling.cdf = cdf;
+	sampling.cdf_user_data = cdf_user_data;
+	sampling.num_bins = RKTEST_KOLMOGOROV_SMIRNOV_NUM_BINS;
+	sampling.num_samples = num_samples;
+	draw_samples(&sampling);
+
+	/* Largest distance between the empirical and expected CDF at bin edges */
+	const bool is_impossible = sampling.counts[RKTEST_KOLMOGOROV_SMIRNOV_NUM_BINS] > 0;
+	double max_distance = 0.0;
+	uint64_t cumulative_count = 0;
+	for (size_t i = 0; i < RKTEST_KOLMOGOROV_SMIRNOV_NUM_BINS; i++) {
+		cumulative_count += sampling.counts[i];
+		const double distance = fabs((double)cumulative_count / (double)num_samples - (double)(i + 1) / RKTEST_KOLMOGOROV_SMIRNOV_NUM_BINS);
+		max_distance = distance > max_distance ? distance : max_distance;
+	}
+	free(sampling.counts);
 
-		rktest_test_t test = **it;
+	if (is_impossible) {
+		return 0.0;
+	}
+	if (num_samples == 0) {
+		return 1.0;
+	}
+	const double sqrt_n = sqrt((double)num_samples);
+	return kolmogorov_q((sqrt_n + 0.12 + 0.11 / sqrt_n) * max_distance);
+}
 
-		/* Find or add test suite */
-		rktest_suite_t* suite = find_suite_with_name(env.test_suites, test.suite_name);
-		if (!suite) {
-			rktest_suite_t new_suite = { 0 };
-			new_suite.name = test.suite_name;
-			vec_push(env.test_suites, new_suite);
-			suite = &vec_back(env.test_suites);
-		}
+double rktest_kolmogorov_smirnov_p_value(rktest_sample_fn sample, void* user_data, uint64_t num_samples, rktest_cdf_fn cdf, void* cdf_user_data) {
+	suspend_oom_sweep();
+	const double result = kolmogorov_smirnov_p_value(sample, user_data, num_samples, cdf, cdf_user_data);
+	resume_oom_sweep();
+	return result;
+}
+
+double rktest_p_value_threshold(void) {
+	return g_p_value_threshold;
+}
+
+/* ------------------------------ Data cache ------------------------------- */
+static vec_t(rktest_cached_data_t) g_cached_data = vec_new();
+
+// Returns the directory of data kept across runs, creating it on first use.
+// Without --rktest_cache_dir this is `<executable>.cache`, or a directory in
+// the temp directory if the one of the executable is read-only.
+static const char* get_cache_dir(void) {
+	static bool s_is_resolved = false;
+	if (s_is_resolved) {
+		return g_cache_dir;
+	}
+	s_is_resolved = true;
+	if (*g_cache_dir) {
+		rktest_mkdir(g_cache_dir);
+		return g_cache_dir;
+	}
+
+	const char* executable = *g_executable_path ? g_executable_path : "rktest";
+	const int length = snprintf(g_cache_dir, sizeof(g_cache_dir), "%s.cache", executable);
+	if (length > 0 && length < (int)sizeof(g_cache_dir)) {
+		rktest_mkdir(g_cache_dir);
+		if (rktest_access(g_cache_dir, RKTEST_W_OK) == 0) {
+			return g_cache_dir;
+		}
+	}
+
+	const char* name = executable;
+	for (const char* c = executable; *c; c++) {
+		if (*c == '/' || *c == '\\') {
+			name = c + 1;
+		}
+	}
+#ifdef _WIN32
+	const char* temp_dir = getenv("TEMP");
+#else
+	const char* temp_dir = getenv("TMPDIR");
+#endif
+	if (snprintf(g_cache_dir, sizeof(g_cache_dir), "%s/rktest-%.200s.cache", temp_dir && *temp_dir ? temp_dir : "/tmp", name) > 0) {
+		rktest_mkdir(g_cache_dir);
+	}
+	return g_cache_dir;
+}
+
+static uint64_t fnv1a_hash(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+#ifdef __linux__
+// Hashes the GNU build-id note of the main program, found through its program headers
+static uint64_t hash_gnu_build_id(uint64_t hash) {
+	const ElfW(Phdr)* phdrs = (const ElfW(Phdr)*)getauxval(AT_PHDR);
+	const size_t num_phdrs = (size_t)getauxval(AT_PHNUM);
+	uintptr_t load_address = 0;
+	for (size_t i = 0; i < num_phdrs; i++) {
+		if (phdrs[i].p_type == PT_PHDR) {
+			load_address = (uintptr_t)phdrs - phdrs[i].p_vaddr;
+		}
+	}
+	for (size_t i = 0; phdrs && i < num_phdrs; i++) {
+		if (phdrs[i].p_type != PT_NOTE) {
+			continue;
+		}
+		const char* note = (const char*)(load_address + phdrs[i].p_vaddr);
+		const char* notes_end = note + phdrs[i].p_memsz;
+		while (note + sizeof(ElfW(Nhdr)) <= notes_end) {
+			const ElfW(Nhdr)* header = (const ElfW(Nhdr)*)note;
+			const char* name = note + sizeof(ElfW(Nhdr));
+			const char* desc = name + ((header->n_namesz + 3) & ~3u);
+			if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+				return fnv1a_hash(hash, desc, header->n_descsz);
+			}
+			note = desc + ((header->n_descsz + 3) & ~3u);
+		}
+	}
+	return hash;
+}
+#endif
+
+// Returns a hash identifying the build of the test program
+static uint64_t get_build_id(void) {
+	const uint64_t fnv_offset_basis = 0xcbf29ce484222325ull;
+	uint64_t hash = fnv_offset_basis;
+#ifdef __linux__
+	hash = hash_gnu_build_id(hash);
+	if (hash != fnv_offset_basis) {
+		return hash;
+	}
+#endif
+#ifdef _MSC_VER
+	struct _stat info;
+	const int result = _stat(g_executable_path, &info);
+#else
+	struct stat info;
+	const int result = stat(g_executable_path, &info);
+#endif
+	if (result == 0) {
+		const uint64_t size = (uint64_t)info.st_size;
+		const uint64_t mtime = (uint64_t)info.st_mtime;
+		hash = fnv1a_hash(hash, &size, sizeof(size));
+		hash = fnv1a_hash(hash, &mtime, sizeof(mtime));
+	}
+	return hash;
+}
+
+// Formats `<cache dir>/<key>-<key hash>.<version>.cache`, where characters of
+// the key that are not allowed in file names are replaced, and the hash of the
+// original key keeps e.g. "a/b" and "a_b" apart.
+static void format_cache_path(char* buf, size_t buf_size, const char* key, uint64_t key_hash, uint32_t version) {
+	int length = snprintf(buf, buf_size, "%s/", get_cache_dir());
+	for (const char* c = key; *c && length + 48 < (int)buf_size; c++) {
+		buf[length++] = isalnum((unsigned char)*c) || *c == '-' ? *c : '_';
+	}
+	snprintf(buf + length, buf_size - (size_t)length, "-%016llx.%u.cache", (unsigned long long)key_hash, (unsigned)version);
+}
+
+static void* map_file_read_only(const char* path, size_t* size) {
+#ifdef _MSC_VER
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	LARGE_INTEGER file_size;
+	HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	*size = data ? (size_t)file_size.QuadPart : 0;
+	return data;
+#else
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	void* data = fstat(fd, &info) == 0 && info.st_size > 0 ? mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	*size = data != MAP_FAILED ? (size_t)info.st_size : 0;
+	return data != MAP_FAILED ? data : NULL;
+#endif
+}
+
+static void unmap_file(void* data, size_t size) {
+#ifdef _MSC_VER
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+// Maps the cache file at `path` if it matches `expected`, else returns false
+static bool map_cache_file(const char* path, const rktest_cache_header_t* expected, rktest_cached_data_t* cached) {
+	size_t mapping_size = 0;
+	void* mapping = map_file_read_only(path, &mapping_size);
+	if (!mapping) {
+		return false;
+	}
+	const rktest_cache_header_t* header = mapping;
+	const bool is_valid = mapping_size >= RKTEST_CACHE_DATA_OFFSET
+		&& memcmp(header->magic, expected->magic, sizeof(header->magic)) == 0
+		&& header->build_id == expected->build_id
+		&& header->key_hash == expected->key_hash
+		&& header->version == expected->version
+		&& header->data_size == mapping_size - RKTEST_CACHE_DATA_OFFSET;
+	if (!is_valid) {
+		unmap_file(mapping, mapping_size);
+		return false;
+	}
+	cached->mapping = mapping;
+	cached->mapping_size = mapping_size;
+	cached->data = (const char*)mapping + RKTEST_CACHE_DATA_OFFSET;
+	cached->size = (size_t)header->data_size;
+	return true;
+}
+
+// Runs the generator into a temporary file, which is then renamed to `path`
+// so that concurrent test runs never see a partially written cache file.
+static bool write_cache_file(const char* path, rktest_cache_header_t* header, rktest_generator_fn generate) {
+	char temp_path[RKTEST_MAX_PATH_LENGTH + 32];
+	snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, (int)rktest_getpid());
+	FILE* file = fopen(temp_path, "wb");
+	if (!file) {
+		return false;
+	}
+	const char padding[RKTEST_CACHE_DATA_OFFSET] = { 0 };
+	fwrite(padding, 1, sizeof(padding), file);
+	generate(file);
+	fflush(file);
+	const int64_t end = (int64_t)rktest_ftell(file);
+	header->data_size = end > RKTEST_CACHE_DATA_OFFSET ? (uint64_t)(end - RKTEST_CACHE_DATA_OFFSET) : 0;
+	fseek(file, 0, SEEK_SET);
+	fwrite(header, sizeof(*header), 1, file);
+	const bool is_written = !ferror(file) && end >= RKTEST_CACHE_DATA_OFFSET;
+	fclose(file);
+#ifdef _MSC_VER
+	remove(path);
+#endif
+	if (!is_written || rename(temp_path, path) != 0) {
+		remove(temp_path);
+		return false;
+	}
+	return true;
+}
+
+// Runs the generator into memory, for when the cache directory is not writable
+static void generate_into_memory(rktest_generator_fn generate, rktest_cached_data_t* cached) {
+	FILE* file = tmpfile();
+	void* data = NULL;
+	size_t size = 0;
+	if (file) {
+		generate(file);
+		fflush(file);
+		const int64_t end = (int64_t)rktest_ftell(file);
+		size = end > 0 ? (size_t)end : 0;
+		data = malloc(size > 0 ? size : 1);
+		fseek(file, 0, SEEK_SET);
+		size = data ? fread(data, 1, size, file) : 0;
+		fclose(file);
+	}
+	cached->data = data;
+	cached->size = size;
+}
+
+// Returns the data written by `generate`, cached on disk under `key` and
+// `version` for the current build of the test program
+static const void* get_cached_data(const char* key, uint32_t version, rktest_generator_fn generate, size_t* size) {
+	vec_foreach(const rktest_cached_data_t*, cached, g_cached_data) {
+		if (strcmp(cached->key, key) == 0 && cached->version == version) {
+			*size = cached->size;
+			return cached->data;
+		}
+	}
+
+	rktest_cache_header_t header = { { 'R', 'K', 'T', 'C', 'A', 'C', 'H', 'E' }, 0, 0, 0, 0 };
+	header.build_id = get_build_id();
+	header.key_hash = fnv1a_hash(0xcbf29ce484222325ull, key, strlen(key));
+	header.version = version;
+
+	char path[RKTEST_MAX_PATH_LENGTH];
+	format_cache_path(path, sizeof(path), key, header.key_hash, version);
+	rktest_cached_data_t cached = { 0 };
+	cached.key = string_duplicate(key);
+	cached.version = version;
+	if (!map_cache_file(path, &header, &cached)) {
+		if (!write_cache_file(path, &header, generate) || !map_cache_file(path, &header, &cached)) {
+			fprintf(stderr, "Warning: Could not cache %s in %s\n", key, path);
+			generate_into_memory(generate, &cached);
+		}
+	}
+	vec_push(g_cached_data, cached);
+	*size = cached.size;
+	return cached.data;
+}
+
+const void* rktest_cached_data(const char* key, uint32_t version, rktest_generator_fn generate, size_t* size) {
+	suspend_oom_sweep();
+	const void* result = get_cached_data(key, version, generate, size);
+	resume_oom_sweep();
+	return result;
+}
+
+static void free_cached_data(void) {
+	vec_foreach(rktest_cached_data_t*, cached, g_cached_data) {
+		if (cached->mapping) {
+			unmap_file(cached->mapping, cached->mapping_size);
+		} else {
+			free((void*)cached->data);
+		}
+		free(cached->key);
+	}
+	vec_free(g_cached_data);
+}
+
+/* -------------------------------- Subtests ------------------------------- */
+// State of the RKTEST_SUBTEST() of the running test
+typedef struct {
+	const rktest_test_t* test;
+	const char* filter; // after the slash of the test filter, or NULL to run all subtests
+	bool print_time;
+	bool print_passed; // false with the progress line, which is for failures
+	bool is_running;
+	bool test_failed; // before the running subtest
+	bool test_skipped;
+	char full_name[2 * RKTEST_MAX_TEST_NAME_LENGTH]; // suite.test/subtest
+	rktest_timer_t timer;
+} rktest_subtests_t;
+
+static rktest_subtests_t g_subtests;
+
+static void begin_subtests(const rktest_test_t* test, const rktest_config_t* config) {
+	const char* slash = strchr(config->test_filter, '/');
+	g_subtests = (rktest_subtests_t) { 0 };
+	g_subtests.test = test;
+	g_subtests.filter = slash ? slash + 1 : NULL;
+	g_subtests.print_time = config->print_timestamps_enabled;
+	g_subtests.print_passed = !config->progress_enabled;
+}
+
+static void print_subtest_outcome(const char* full_name, rktest_millis_t time_ms) {
+	if (g_current_test_failed) {
+		rktest_printf_red("[  FAILED  ] ");
+	} else if (g_current_test_skipped) {
+		rktest_printf_yellow("[  SKIPPED ] ");
+	} else {
+		rktest_printf_green("[       OK ] ");
+	}
+	printf("%s ", full_name);
+	if (g_subtests.print_time) {
+		printf("(%d ms)", time_ms);
+	}
+	printf("\n");
+}
+
+static void end_subtest(void) {
+	if (!g_subtests.is_running) {
+		return;
+	}
+	g_subtests.is_running = false;
+	const rktest_millis_t subtest_time_ms = rktest_timer_stop(&g_subtests.timer);
+	const bool passed = !g_current_test_failed && !g_current_test_skipped;
+	if (!passed || g_subtests.print_passed) {
+		print_subtest_outcome(g_subtests.full_name, subtest_time_ms);
+	}
+
+	/* The outcome of the subtest also counts for the test */
+	g_current_test_failed = g_current_test_failed || g_subtests.test_failed;
+	g_current_test_skipped = g_current_test_skipped || g_subtests.test_skipped;
+}
+
+bool rktest_end_subtest(void) {
+	suspend_oom_sweep();
+	end_subtest();
+	resume_oom_sweep();
+	return false;
+}
+
+static bool begin_subtest(const char* name_format, va_list args) {
+	if (!g_subtests.test) {
+		printf("error: RKTEST_SUBTEST() can only be used in tests\n");
+		rktest_fail_current_test();
+		return false;
+	}
+	if (g_subtests.is_running) {
+		end_subtest();
+	}
+
+	char name[RKTEST_MAX_TEST_NAME_LENGTH];
+	vsnprintf(name, sizeof(name), name_format, args);
+	if (g_subtests.filter && !string_wildcard_match(name, g_subtests.filter)) {
+		return false;
+	}
+
+	snprintf(g_subtests.full_name, sizeof(g_subtests.full_name), "%s.%s/%s", g_subtests.test->suite_name, g_subtests.test->test_name, name);
+	g_subtests.test_failed = g_current_test_failed;
+	g_subtests.test_skipped = g_current_test_skipped;
+	g_current_test_failed = false;
+	g_current_test_skipped = false;
+	g_subtests.is_running = true;
+	g_subtests.timer = rktest_timer_start();
+	return true;
+}
+
+bool rktest_begin_subtest(const char* name_format, ...) {
+	suspend_oom_sweep();
+	va_list args;
+	va_start(args, name_format);
+	const bool is_running = begin_subtest(name_format, args);
+	va_end(args);
+	resume_oom_sweep();
+	return is_running;
+}
+
+// Ends the subtests of a test, including one left by an ASSERT_* or RKTEST_SKIP()
+static void end_subtests(void) {
+	end_subtest();
+	g_subtests.test = NULL;
+}
+
+/* --------------------------- Data-driven tests --------------------------- */
+// Resolves the case file path of a TEST_DATA() relative to --rktest_data_dir,
+// else to RKTEST_DATA_DIR, else to its source file
+static void format_data_path(char* buf, size_t buf_size, const rktest_test_t* test) {
+	const char* path = test->data_path;
+	const bool is_absolute = path[0] == '/' || path[0] == '\\' || (path[0] != '\0' && path[1] == ':');
+	const char* data_dir = *g_data_dir ? g_data_dir : test->data_dir;
+	if (!is_absolute && data_dir && *data_dir) {
+		const char last = data_dir[strlen(data_dir) - 1];
+		snprintf(buf, buf_size, "%s%s%s", data_dir, last == '/' || last == '\\' ? "" : "/", path);
+		return;
+	}
+	const char* separator = strrchr(test->source_path, '/');
+	const char* backslash = strrchr(test->source_path, '\\');
+	if (backslash && (!separator || backslash > separator)) {
+		separator = backslash;
+	}
+	if (is_absolute || !separator) {
+		snprintf(buf, buf_size, "%s", path);
+		return;
+	}
+	snprintf(buf, buf_size, "%.*s%s", (int)(separator - test->source_path + 1), test->source_path, path);
+}
+
+// Runs the body of a TEST_DATA() once per record of its shard of the case file
+// Only the test body of each record runs under the allocation failure sweep
+static void run_data_test(const rktest_test_t* test) {
+	suspend_oom_sweep();
+	char path[RKTEST_MAX_PATH_LENGTH];
+	format_data_path(path, sizeof(path), test);
+	size_t mapping_size = 0;
+	const char* mapping = map_file_read_only(path, &mapping_size);
+	if (!mapping) {
+		FILE* file = fopen(path, "rb");
+		if (!file) {
+			printf("error: Could not open test data file %s\n", path);
+			rktest_fail_current_test();
+			resume_oom_sweep();
+			return;
+		}
+		fclose(file); // empty file
+	}
+
+	const size_t path_length = strlen(path);
+	bool skip_header = path_length >= 4 && rktest_strcasecmp(path + path_length - 4, ".csv") == 0;
+	const size_t num_shards = test->num_shards > 0 ? test->num_shards : 1;
+	size_t record_index = 0;
+	const char* end = mapping + mapping_size;
+	size_t line = 1;
+	for (const char* start = mapping; start && start < end; line++) {
+		const char* newline = memchr(start, '\n', (size_t)(end - start));
+		const char* line_end = newline ? newline : end;
+		rktest_record_t record = { start, (size_t)(line_end - start), line };
+		start = newline ? newline + 1 : end;
+		if (record.size > 0 && record.data[record.size - 1] == '\r') {
+			record.size--;
+		}
+		if (record.size == 0) {
+			continue;
+		}
+		if (skip_header) {
+			skip_header = false;
+			continue;
+		}
+		if (record_index++ % num_shards != test->shard) {
+			continue;
+		}
+
+		/* A skipped record does not skip the test */
+		const bool test_skipped = g_current_test_skipped;
+		if (rktest_begin_subtest("line_%zu", record.line)) {
+			resume_oom_sweep();
+			test->run_record(&record);
+			suspend_oom_sweep();
+			rktest_end_subtest();
+			g_current_test_skipped = test_skipped;
+		}
+	}
+
+	if (mapping) {
+		unmap_file((void*)mapping, mapping_size);
+	}
+	resume_oom_sweep();
+}
+
+/* ----------------------------- Indexed tests ----------------------------- */
+static void format_index_name(char* buf, size_t buf_size, const rktest_test_t* test, uint64_t index) {
+	if (test->format_index_name) {
+		test->format_index_name(buf, buf_size, index);
+	} else {
+		snprintf(buf, buf_size, "%llu", (unsigned long long)index);
+	}
+}
+
+// Runs the body of a TEST_INDEXED() for each index of its shard. Only the
+// instances to filter or to report get a name.
+// Only the test body of each index runs under the allocation failure sweep
+static void run_indexed_test(const rktest_test_t* test) {
+	suspend_oom_sweep();
+	const uint64_t num_shards = test->num_shards > 0 ? test->num_shards : 1;
+	const uint64_t shard_size = test->num_indices / num_shards;
+	const uint64_t remainder = test->num_indices % num_shards;
+	const uint64_t first = test->shard * shard_size + (test->shard < remainder ? test->shard : remainder);
+	const uint64_t last = first + shard_size + (test->shard < remainder ? 1 : 0);
+
+	bool test_failed = g_current_test_failed;
+	const bool test_skipped = g_current_test_skipped;
+	char name[RKTEST_MAX_TEST_NAME_LENGTH];
+	for (uint64_t index = first; index < last; index++) {
+		if (g_subtests.filter) {
+			format_index_name(name, sizeof(name), test, index);
+			if (!string_wildcard_match(name, g_subtests.filter)) {
+				continue;
+			}
+		}
+
+		g_current_test_failed = false;
+		g_current_test_skipped = false;
+		rktest_timer_t timer = rktest_timer_start();
+		resume_oom_sweep();
+		test->run_index(index);
+		suspend_oom_sweep();
+		const rktest_millis_t time_ms = rktest_timer_stop(&timer);
+		if (g_current_test_failed || g_current_test_skipped) {
+			char full_name[2 * RKTEST_MAX_TEST_NAME_LENGTH];
+			format_index_name(name, sizeof(name), test, index);
+			snprintf(full_name, sizeof(full_name), "%s.%s/%s", test->suite_name, test->test_name, name);
+			print_subtest_outcome(full_name, time_ms);
+		}
+		test_failed = test_failed || g_current_test_failed;
+	}
+
+	/* A skipped instance does not skip the test */
+	g_current_test_failed = test_failed;
+	g_current_test_skipped = test_skipped;
+	resume_oom_sweep();
+}
+
+/* ------------------------- Runtime registration -------------------------- */
+static vec_t(rktest_test_t) g_registered_tests = vec_new(); // by rktest_register_test()
+static vec_t(char*) g_registered_names = vec_new();
+static bool g_registration_is_running = false;
+
+void rktest_register_test(const char* suite_name, const char* test_name, rktest_test_fn run, void* context) {
+	if (!g_registration_is_running) {
+		printf("error: rktest_register_test() can only be called from RKTEST_REGISTRATION_HOOK()\n");
+		rktest_fail_current_test();
+		return;
+	}
+	vec_push(g_registered_names, string_duplicate(suite_name));
+	vec_push(g_registered_names, string_duplicate(test_name));
+	rktest_test_t test = { 0 };
+	test.suite_name = g_registered_names[vec_len(g_registered_names) - 2];
+	test.test_name = vec_back(g_registered_names);
+	test.run_with_context = run;
+	test.context = context;
+	vec_push(g_registered_tests, test);
+}
+
+static void run_registration_hooks(void) {
+	g_registration_is_running = true;
+	for (const rktest_test_t* const* it = TEST_DATA_BEGIN; it != TEST_DATA_END; it++) {
+		if (*it != NULL && (*it)->registration_hook) {
+			(*it)->registration_hook();
+		}
+	}
+	g_registration_is_running = false;
+}
+
+static size_t get_num_test_definitions(void) {
+	return (size_t)(TEST_DATA_END - TEST_DATA_BEGIN) + vec_len(g_registered_tests);
+}
+
+// Returns the i-th test definition, with the ones of TEST() and friends before
+// the ones of rktest_register_test(). NULL for padding of the memory section.
+static const rktest_test_t* get_test_definition(size_t i) {
+	const size_t num_static_definitions = (size_t)(TEST_DATA_END - TEST_DATA_BEGIN);
+	return i < num_static_definitions ? TEST_DATA_BEGIN[i] : &g_registered_tests[i - num_static_definitions];
+}
+
+static void free_registered_tests(void) {
+	vec_foreach(char**, name, g_registered_names) {
+		free(*name);
+	}
+	vec_free(g_registered_names);
+	vec_free(g_registered_tests);
+}
+
+/* ---------------------------- Shared fixtures ---------------------------- */
+// Memory allocated with rktest_shared_alloc()
+typedef struct {
+	void* data;
+	size_t size;
+} rktest_shared_allocation_t;
+
+static vec_t(rktest_shared_allocation_t) g_shared_allocations = vec_new();
+static bool g_shared_setup_is_running = false;
+
+void* rktest_shared_alloc(size_t size) {
+	if (!g_shared_setup_is_running) {
+		printf("error: rktest_shared_alloc() can only be called from SHARED_SETUP()\n");
+		rktest_fail_current_test();
+		return NULL;
+	}
+	const size_t mapping_size = size > 0 ? size : 1;
+#ifdef _MSC_VER
+	void* data = VirtualAlloc(NULL, mapping_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	void* data = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		data = NULL;
+	}
+#endif
+	if (data) {
+		rktest_shared_allocation_t allocation = { data, mapping_size };
+		vec_push(g_shared_allocations, allocation);
+	}
+	return data;
+}
+
+// Runs `fixture` with its assertion failures and skips going to `status`
+static void run_suite_fixture(void (*fixture)(void), rktest_fixture_status_t* status) {
+	rktest_fixture_status_t* previous_status = g_fixture_status;
+	g_fixture_status = status;
+	fixture();
+	g_fixture_status = previous_status;
+}
+
+// Runs the SHARED_SETUP() of every suite with tests to run, then makes the
+// memory they allocated read-only. Forked workers inherit the mappings, and
+// the outcome of each setup in its suite.
+static void run_shared_setups(rktest_environment_t* env) {
+	g_shared_setup_is_running = true;
+	vec_foreach(rktest_suite_t*, suite, env->test_suites) {
+		if (suite->shared_setup && suite->num_disabled_tests < vec_len(suite->tests)) {
+			run_suite_fixture(suite->shared_setup, &suite->shared_setup_status);
+			if (suite->shared_setup_status.failed) {
+				rktest_log_error("[  FAILED  ] ", "%s.SHARED_SETUP\n", suite->name);
+			}
+		}
+	}
+	g_shared_setup_is_running = false;
+
+	vec_foreach(rktest_shared_allocation_t*, allocation, g_shared_allocations) {
+#ifdef _MSC_VER
+		DWORD old_protection;
+		VirtualProtect(allocation->data, allocation->size, PAGE_READONLY, &old_protection);
+#else
+		mprotect(allocation->data, allocation->size, PROT_READ);
+#endif
+	}
+}
+
+static void free_shared_allocations(void) {
+	vec_foreach(rktest_shared_allocation_t*, allocation, g_shared_allocations) {
+#ifdef _MSC_VER
+		VirtualFree(allocation->data, 0, MEM_RELEASE);
+#else
+		munmap(allocation->data, allocation->size);
+#endif
+	}
+	vec_free(g_shared_allocations);
+}
+
+/* ------------------------- Resource leak checking ------------------------ */
+#ifdef __linux__
+// Lists the numerically named entries of a /proc directory, e.g. the file
+// descriptors in /proc/self/fd or the thread ids in /proc/self/task.
+static vec_t(int) list_proc_ids(const char* path, bool skip_own_fd) {
+	vec_t(int) ids = vec_new();
+	DIR* dir = opendir(path);
+	if (!dir) {
+		return ids;
+	}
+
+	const int own_fd = skip_own_fd ? dirfd(dir) : -1;
+	for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+		if (!rktest_string_is_number(entry->d_name)) {
+			continue;
+		}
+		const int id = atoi(entry->d_name);
+		if (id != own_fd) {
+			vec_push(ids, id);
+		}
+	}
+	closedir(dir);
+
+	return ids;
+}
+#endif
+
+static rktest_resource_snapshot_t take_resource_snapshot(void) {
+	rktest_resource_snapshot_t snapshot = { 0 };
+#ifdef __linux__
+	snapshot.fds = list_proc_ids("/proc/self/fd", true);
+	snapshot.threads = list_proc_ids("/proc/self/task", false);
+#endif
+	return snapshot;
+}
+
+static void free_resource_snapshot(rktest_resource_snapshot_t* snapshot) {
+	vec_free(snapshot->fds);
+	vec_free(snapshot->threads);
+}
+
+static bool ids_contain(vec_t(int) ids, int id) {
+	vec_foreach(const int*, it, ids) {
+		if (*it == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Prints every file descriptor and thread present in `after` but not in
+// `before`, and returns the number of leaked resources.
+static size_t print_leaked_resources(const rktest_resource_snapshot_t* before, const rktest_resource_snapshot_t* after, bool is_error) {
+	const char* severity = is_error ? "error" : "warning";
+	size_t num_leaks = 0;
+
+	vec_foreach(const int*, fd, after->fds) {
+		if (ids_contain(before->fds, *fd)) {
+			continue;
+		}
+		char target[256] = "?";
+#ifdef __linux__
+		char link_path[64];
+		snprintf(link_path, sizeof(link_path), "/proc/self/fd/%d", *fd);
+		const ssize_t target_len = readlink(link_path, target, sizeof(target) - 1);
+		if (target_len >= 0) {
+			target[target_len] = '\0';
+		}
+#endif
+		printf("%s: Leaked file descriptor %d -> %s\n", severity, *fd, target);
+		num_leaks++;
+	}
+
+	vec_foreach(const int*, tid, after->threads) {
+		if (ids_contain(before->threads, *tid)) {
+			continue;
+		}
+		char name[64] = "?";
+#ifdef __linux__
+		char comm_path[64];
+		snprintf(comm_path, sizeof(comm_path), "/proc/self/task/%d/comm", *tid);
+		FILE* comm_file = fopen(comm_path, "r");
+		if (comm_file) {
+			if (fgets(name, sizeof(name), comm_file)) {
+				name[strcspn(name, "\n")] = '\0';
+			}
+			fclose(comm_file);
+		}
+#endif
+		printf("%s: Leaked thread %d (%s)\n", severity, *tid, name);
+		num_leaks++;
+	}
+
+	return num_leaks;
+}
+
+/* ----------------------- Allocation failure sweep ------------------------ */
+// With RKTEST_INTERPOSE_MALLOC defined, RK Test replaces the malloc family of
+// functions with wrappers around the glibc implementations. While sweeping a
+// test, each allocation made by the test body forks the process. The child sees
+// the allocation fail and runs the remainder of the test, while the parent
+// waits for it and then continues with the allocation succeeding. This way the
+// code leading up to an allocation only runs once, instead of once per
+// allocation as when re-running the test with the k:th allocation failing.
+static rktest_oom_sweep_t g_oom_sweep = { 0 };
+
+#ifdef RKTEST_OOM_SWEEP_SUPPORTED
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t num, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+// Returns true if the current allocation should fail, i.e. if we're the child
+// process of a fork at this allocation.
+static bool oom_sweep_fail_allocation(void) {
+	if (!g_oom_sweep_is_injecting || g_oom_sweep_num_suspensions > 0 || g_oom_sweep.is_child || g_oom_sweep.in_hook) {
+		return false;
+	}
+
+	g_oom_sweep.in_hook = true;
+	const size_t allocation_index = ++g_oom_sweep.num_allocations;
+	fflush(stdout);
+	const pid_t pid = fork();
+	if (pid == 0) {
+		/* Child: silence the test output and fail this allocation */
+		const int devnull_fd = open("/dev/null", O_WRONLY);
+		if (devnull_fd >= 0) {
+			dup2(devnull_fd, fileno(stdout));
+			close(devnull_fd);
+		}
+		g_oom_sweep.is_child = true;
+		g_oom_sweep.in_hook = false;
+		errno = ENOMEM;
+		return true;
+	}
+	if (pid > 0) {
+		rktest_oom_result_t result = { 0 };
+		result.allocation_index = allocation_index;
+		waitpid(pid, &result.wait_status, 0);
+		vec_push(g_oom_sweep.results, result);
+	}
+	g_oom_sweep.in_hook = false;
+	return false;
+}
+
+static void oom_sweep_count_allocation(long delta) {
+	if (g_oom_sweep_is_counting && g_oom_sweep_num_suspensions == 0 && !g_oom_sweep.in_hook) {
+		g_oom_sweep.net_allocations += delta;
+	}
+}
+
+void* malloc(size_t size) {
+	if (oom_sweep_fail_allocation()) {
+		return NULL;
+	}
+	void* ptr = __libc_malloc(size);
+	if (ptr) {
+		oom_sweep_count_allocation(1);
+	}
+	return ptr;
+}
+
+void* calloc(size_t num, size_t size) {
+	if (oom_sweep_fail_allocation()) {
+		return NULL;
+	}
+	void* ptr = __libc_calloc(num, size);
+	if (ptr) {
+		oom_sweep_count_allocation(1);
+	}
+	return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+	if (oom_sweep_fail_allocation()) {
+		return NULL;
+	}
+	void* new_ptr = __libc_realloc(ptr, size);
+	if (!ptr && new_ptr) {
+		oom_sweep_count_allocation(1);
+	} else if (ptr && size == 0) {
+		oom_sweep_count_allocation(-1);
+	}
+	return new_ptr;
+}
+
+void free(void* ptr) {
+	if (ptr) {
+		oom_sweep_count_allocation(-1);
+	}
+	__libc_free(ptr);
+}
+#endif // RKTEST_OOM_SWEEP_SUPPORTED
+
+static bool oom_sweep_enabled_for(const rktest_test_t* test, const rktest_config_t* config) {
+#ifdef RKTEST_OOM_SWEEP_SUPPORTED
+	if (*config->oom_sweep_filter == '\0') {
+		return false;
+	}
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	format_full_test_name(full_test_name, sizeof(full_test_name), test);
+	return string_wildcard_match(full_test_name, config->oom_sweep_filter);
+#else
+	(void)test;
+	(void)config;
+	return false;
+#endif
+}
+
+static void begin_oom_sweep(void) {
+	vec_free(g_oom_sweep.results);
+	g_oom_sweep.num_allocations = 0;
+	g_oom_sweep.net_allocations = 0;
+	g_oom_sweep_is_counting = true;
+}
+
+// Called after teardown. Children exit here with the number of leaked
+// allocations as exit code, while the parent prints the outcome of each child.
+// Returns the number of allocation failures that were not handled correctly.
+static size_t end_oom_sweep(void) {
+	size_t num_errors = 0;
+	g_oom_sweep_is_counting = false;
+
+#ifdef RKTEST_OOM_SWEEP_SUPPORTED
+	const long leaked_allocations = g_oom_sweep.net_allocations > 0 ? g_oom_sweep.net_allocations : 0;
+	if (g_oom_sweep.is_child) {
+		_exit(leaked_allocations < 200 ? (int)leaked_allocations : 200);
+	}
+
+	vec_foreach(const rktest_oom_result_t*, result, g_oom_sweep.results) {
+		if (WIFSIGNALED(result->wait_status)) {
+			printf("error: Crashed with signal %d when allocation %zu of %zu failed\n", WTERMSIG(result->wait_status), result->allocation_index, g_oom_sweep.num_allocations);
+			num_errors++;
+		} else if (WIFEXITED(result->wait_status) && WEXITSTATUS(result->wait_status) > leaked_allocations) {
+			const int num_leaked = WEXITSTATUS(result->wait_status) - (int)leaked_allocations;
+			printf("error: Leaked %d allocation%s when allocation %zu of %zu failed\n", num_leaked, num_leaked > 1 ? "s" : "", result->allocation_index, g_oom_sweep.num_allocations);
+			num_errors++;
+		}
+	}
+	vec_free(g_oom_sweep.results);
+#endif
+
+	return num_errors;
+}
+
+/* ------------------------- Performance counters -------------------------- */
+static rktest_perf_t g_perf;
+static bool g_benchmark_failed = false;
+
+static const char* const g_perf_counter_names[RKTEST_PERF_MAX_COUNTERS] = { "instructions", "L1D misses", "LL misses" };
+
+#ifdef __linux__
+static int open_perf_counter(uint32_t type, uint64_t counter) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = counter;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+// Reads lines of `<suite>.<test> <instructions> <L1D misses> <LL misses>`
+static vec_t(rktest_perf_entry_t) load_perf_counts(const char* path) {
+	vec_t(rktest_perf_entry_t) entries = vec_new();
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Warning: could not open perf baseline %s\n", path);
+		return entries;
+	}
+
+	rktest_perf_entry_t entry = { 0 };
+	unsigned long long counts[RKTEST_PERF_MAX_COUNTERS];
+	char line_format[32];
+	snprintf(line_format, sizeof(line_format), "%%%ds %%llu %%llu %%llu", RKTEST_MAX_TEST_NAME_LENGTH - 1);
+	while (fscanf(file, line_format, entry.full_test_name, &counts[0], &counts[1], &counts[2]) == 4) {
+		for (size_t i = 0; i < RKTEST_PERF_MAX_COUNTERS; i++) {
+			entry.counts[i] = counts[i];
+		}
+		vec_push(entries, entry);
+	}
+	fclose(file);
+	return entries;
+}
+
+static void save_perf_counts(const char* path, vec_t(rktest_perf_entry_t) entries) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Warning: could not write perf counts to %s\n", path);
+		return;
+	}
+	vec_foreach(const rktest_perf_entry_t*, entry, entries) {
+		fprintf(file, "%s", entry->full_test_name);
+		for (size_t i = 0; i < RKTEST_PERF_MAX_COUNTERS; i++) {
+			fprintf(file, " %llu", (unsigned long long)entry->counts[i]);
+		}
+		fprintf(file, "\n");
+	}
+	fclose(file);
+}
+
+// Opens the counters of the calling process. Forked children need their own,
+// since counters only count the process that opened them.
+static void open_perf_counters(const rktest_config_t* config, bool print_warnings) {
+#ifdef __linux__
+	g_perf.fds[0] = open_perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	g_perf.is_available = g_perf.fds[0] >= 0;
+	g_perf.num_counters = 1;
+	if (g_perf.is_available && config->perf_counters_mode == RKTEST_PERF_COUNTERS_CACHES) {
+		g_perf.fds[1] = open_perf_counter(PERF_TYPE_HW_CACHE,
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		g_perf.fds[2] = open_perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		if (g_perf.fds[1] >= 0 && g_perf.fds[2] >= 0) {
+			g_perf.num_counters = 3;
+		} else {
+			for (size_t i = 1; i < RKTEST_PERF_MAX_COUNTERS; i++) {
+				if (g_perf.fds[i] >= 0) {
+					close(g_perf.fds[i]);
+				}
+			}
+			if (print_warnings) {
+				fprintf(stderr, "Warning: cache miss counters are not available, only counting instructions\n");
+			}
+		}
+	}
+#else
+	(void)config;
+	(void)print_warnings;
+#endif
+}
+
+static void close_perf_counters(void) {
+#ifdef __linux__
+	for (size_t i = 0; g_perf.is_available && i < g_perf.num_counters; i++) {
+		close(g_perf.fds[i]);
+	}
+#endif
+	g_perf.is_available = false;
+}
+
+// Returns false if a baseline is to be saved or compared without counters,
+// since a gate that silently passes would hide the regressions it is meant for
+static bool start_perf(const rktest_config_t* config) {
+	if (config->perf_counters_mode == RKTEST_PERF_COUNTERS_OFF) {
+		return true;
+	}
+	open_perf_counters(config, true);
+	if (!g_perf.is_available && (*config->perf_save_path || *config->perf_baseline_path)) {
+		fprintf(stderr, "Error: hardware performance counters are not available, which --rktest_perf_save and --rktest_perf_baseline need\n");
+		return false;
+	}
+	if (!g_perf.is_available) {
+		fprintf(stderr, "Warning: hardware performance counters are not available, not counting instructions\n");
+	}
+	if (*config->perf_baseline_path) {
+		g_perf.baseline = load_perf_counts(config->perf_baseline_path);
+	}
+	return true;
+}
+
+static void reset_perf_counters(void) {
+#ifdef __linux__
+	for (size_t i = 0; g_perf.is_available && i < g_perf.num_counters; i++) {
+		ioctl(g_perf.fds[i], PERF_EVENT_IOC_RESET, 0);
+	}
+#endif
+}
+
+// Counting can be paused and resumed, e.g. around the timed regions of a benchmark
+static void pause_perf_counting(void) {
+#ifdef __linux__
+	for (size_t i = 0; g_perf.is_available && i < g_perf.num_counters; i++) {
+		ioctl(g_perf.fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+#endif
+}
+
+static void resume_perf_counting(void) {
+#ifdef __linux__
+	for (size_t i = 0; g_perf.is_available && i < g_perf.num_counters; i++) {
+		ioctl(g_perf.fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+static void begin_perf_counting(void) {
+	reset_perf_counters();
+	resume_perf_counting();
+}
+
+static void end_perf_counting(uint64_t counts[RKTEST_PERF_MAX_COUNTERS]) {
+	memset(counts, 0, RKTEST_PERF_MAX_COUNTERS * sizeof(uint64_t));
+	pause_perf_counting();
+#ifdef __linux__
+	for (size_t i = 0; g_perf.is_available && i < g_perf.num_counters; i++) {
+		if (read(g_perf.fds[i], &counts[i], sizeof(counts[i])) != (ssize_t)sizeof(counts[i])) {
+			counts[i] = 0;
+		}
+	}
+#endif
+}
+
+// Records the counts of a test or benchmark and compares its instructions with
+// the baseline, printing the counts. Returns false on a regression.
+static bool check_perf_counts(const char* full_test_name, const uint64_t counts[RKTEST_PERF_MAX_COUNTERS], const rktest_config_t* config) {
+	if (!g_perf.is_available) {
+		return true;
+	}
+
+	rktest_perf_entry_t entry = { 0 };
+	strncpy(entry.full_test_name, full_test_name, sizeof(entry.full_test_name) - 1);
+	memcpy(entry.counts, counts, sizeof(entry.counts));
+	vec_push(g_perf.results, entry);
+
+	const rktest_perf_entry_t* baseline = NULL;
+	vec_foreach(const rktest_perf_entry_t*, baseline_entry, g_perf.baseline) {
+		if (strcmp(baseline_entry->full_test_name, full_test_name) == 0) {
+			baseline = baseline_entry;
+			break;
+		}
+	}
+
+	printf("perf:");
+	for (size_t i = 0; i < g_perf.num_counters; i++) {
+		printf("%s %llu %s", i > 0 ? "," : "", (unsigned long long)counts[i], g_perf_counter_names[i]);
+		if (baseline && baseline->counts[i] > 0) {
+			printf(" (%+.1f%%)", ((double)counts[i] / (double)baseline->counts[i] - 1.0) * 100.0);
+		}
+	}
+	printf("\n");
+
+	const double max_instructions = baseline ? (double)baseline->counts[0] * (1.0 + config->perf_threshold_percent / 100.0) : 0.0;
+	if (baseline && (double)counts[0] > max_instructions) {
+		printf("error: %llu instructions, more than the baseline of %llu by over %.1f%%\n",
+			(unsigned long long)counts[0], (unsigned long long)baseline->counts[0], config->perf_threshold_percent);
+		g_perf.num_regressions++;
+		return false;
+	}
+	return true;
+}
+
+static void end_perf(const rktest_config_t* config) {
+	if (config->perf_counters_mode == RKTEST_PERF_COUNTERS_OFF) {
+		return;
+	}
+	if (g_perf.is_available && *config->perf_save_path) {
+		save_perf_counts(config->perf_save_path, g_perf.results);
+	}
+	close_perf_counters();
+	vec_free(g_perf.baseline);
+	vec_free(g_perf.results);
+}
+
+/* -------------------------- Progress reporting --------------------------- */
+static int compare_duration_entries(const void* lhs, const void* rhs) {
+	const rktest_duration_entry_t* lhs_entry = lhs;
+	const rktest_duration_entry_t* rhs_entry = rhs;
+	return strcmp(lhs_entry->full_test_name, rhs_entry->full_test_name);
+}
+
+static rktest_duration_entry_t* find_duration_entry(vec_t(rktest_duration_entry_t) history, const char* full_test_name) {
+	if (vec_len(history) == 0) {
+		return NULL;
+	}
+	rktest_duration_entry_t key = { 0 };
+	key.full_test_name = (char*)full_test_name;
+	return bsearch(&key, history, vec_len(history), sizeof(*history), compare_duration_entries);
+}
+
+// Reads lines of `<suite>.<test> <microseconds>` written by a previous run
+static vec_t(rktest_duration_entry_t) load_test_durations(const char* path) {
+	vec_t(rktest_duration_entry_t) history = vec_new();
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		return history;
+	}
+
+	char name[RKTEST_MAX_TEST_NAME_LENGTH];
+	char line_format[32];
+	snprintf(line_format, sizeof(line_format), "%%%ds %%llu", RKTEST_MAX_TEST_NAME_LENGTH - 1);
+	unsigned long long duration_us;
+	while (fscanf(file, line_format, name, &duration_us) == 2) {
+		rktest_duration_entry_t entry = { 0 };
+		entry.full_test_name = string_duplicate(name);
+		entry.duration_us = duration_us;
+		vec_push(history, entry);
+	}
+	fclose(file);
+
+	if (vec_len(history) > 0) {
+		qsort(history, vec_len(history), sizeof(*history), compare_duration_entries);
+	}
+	return history;
+}
+
+static void format_durations_path(char* buf, size_t buf_size) {
+	snprintf(buf, buf_size, "%s/durations", get_cache_dir());
+}
+
+static void save_test_durations(const char* path, const rktest_progress_t* progress) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		return;
+	}
+	vec_foreach(const rktest_duration_entry_t*, entry, progress->history) {
+		fprintf(file, "%s %llu\n", entry->full_test_name, (unsigned long long)entry->duration_us);
+	}
+	vec_foreach(const rktest_duration_entry_t*, entry, progress->new_entries) {
+		fprintf(file, "%s %llu\n", entry->full_test_name, (unsigned long long)entry->duration_us);
+	}
+	fclose(file);
+}
+
+static void redraw_progress(rktest_progress_t* progress, const char* current_test_name, bool force) {
+	const rktest_nanos_t now = rktest_clock_nanos();
+	if (!force && now - progress->last_redraw_ns < RKTEST_PROGRESS_REDRAW_INTERVAL_NS) {
+		return;
+	}
+	progress->last_redraw_ns = now;
+
+	/* Tests without a historical duration are assumed to take the average time */
+	const uint64_t elapsed_us = (now - progress->start_ns) / 1000;
+	const uint64_t average_us = progress->num_done > 0 ? elapsed_us / progress->num_done : 0;
+	const uint64_t eta_s = (progress->remaining_known_us + progress->remaining_unknown * average_us) / 1000000;
+
+	char line[RKTEST_PROGRESS_LINE_WIDTH + RKTEST_MAX_TEST_NAME_LENGTH];
+	snprintf(
+		line,
+		sizeof(line),
+		"[%zu/%zu] %zu failed, ETA %llum%02llus | %s",
+		progress->num_done,
+		progress->num_tests,
+		progress->num_failed,
+		(unsigned long long)(eta_s / 60),
+		(unsigned long long)(eta_s % 60),
+		current_test_name
+	);
+	printf("\r%-*.*s", RKTEST_PROGRESS_LINE_WIDTH, RKTEST_PROGRESS_LINE_WIDTH, line);
+	fflush(stdout);
+}
+
+static void clear_progress(void) {
+	printf("\r%*s\r", RKTEST_PROGRESS_LINE_WIDTH, "");
+	fflush(stdout);
+}
+
+static rktest_progress_t start_progress(const rktest_environment_t* env) {
+	rktest_progress_t progress = { 0 };
+	char durations_path[RKTEST_MAX_PATH_LENGTH + 16];
+	format_durations_path(durations_path, sizeof(durations_path));
+	progress.history = load_test_durations(durations_path);
+	progress.capture_file = tmpfile();
+	progress.saved_stdout_fd = rktest_dup(rktest_fileno(stdout));
+	progress.start_ns = rktest_clock_nanos();
+
+	vec_foreach(const rktest_suite_t*, suite, env->test_suites) {
+		vec_foreach(const rktest_test_t*, test, suite->tests) {
+			if (test->is_disabled) {
+				continue;
+			}
+			char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+			format_full_test_name(full_test_name, sizeof(full_test_name), test);
+			const rktest_duration_entry_t* entry = find_duration_entry(progress.history, full_test_name);
+			if (entry) {
+				progress.remaining_known_us += entry->duration_us;
+			} else {
+				progress.remaining_unknown++;
+			}
+			progress.num_tests++;
+		}
+	}
+
+	return progress;
+}
+
+// Redraws the status line and redirects stdout into the capture file, so that
+// the output of the test can be discarded if it passes.
+static void progress_begin_test(rktest_progress_t* progress, const rktest_test_t* test) {
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	format_full_test_name(full_test_name, sizeof(full_test_name), test);
+	redraw_progress(progress, full_test_name, false);
+
+	if (progress->capture_file) {
+		fflush(stdout);
+		const int capture_fd = rktest_fileno(progress->capture_file);
+		rktest_lseek(capture_fd, 0, SEEK_SET);
+		rktest_dup2(capture_fd, rktest_fileno(stdout));
+	}
+	progress->test_start_ns = rktest_clock_nanos();
+}
+
+static void progress_end_test(rktest_progress_t* progress, const rktest_test_t* test, bool test_passed) {
+	const uint64_t duration_us = (rktest_clock_nanos() - progress->test_start_ns) / 1000;
+
+	/* Restore stdout and print the captured output of failing tests */
+	if (progress->capture_file) {
+		fflush(stdout);
+		const int capture_fd = rktest_fileno(progress->capture_file);
+		long remaining = (long)rktest_lseek(capture_fd, 0, SEEK_CUR);
+		rktest_dup2(progress->saved_stdout_fd, rktest_fileno(stdout));
+		if (!test_passed && remaining > 0) {
+			clear_progress();
+			char buf[4096];
+			rktest_lseek(capture_fd, 0, SEEK_SET);
+			while (remaining > 0) {
+				const unsigned chunk_size = remaining < (long)sizeof(buf) ? (unsigned)remaining : (unsigned)sizeof(buf);
+				const int num_read = (int)rktest_read(capture_fd, buf, chunk_size);
+				if (num_read <= 0) {
+					break;
+				}
+				fwrite(buf, 1, (size_t)num_read, stdout);
+				remaining -= num_read;
+			}
+		}
+	}
+
+	/* Update estimate and history */
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	format_full_test_name(full_test_name, sizeof(full_test_name), test);
+	rktest_duration_entry_t* entry = find_duration_entry(progress->history, full_test_name);
+	if (entry) {
+		progress->remaining_known_us -= entry->duration_us < progress->remaining_known_us ? entry->duration_us : progress->remaining_known_us;
+		entry->duration_us = duration_us;
+	} else {
+		progress->remaining_unknown--;
+		rktest_duration_entry_t new_entry = { 0 };
+		new_entry.full_test_name = string_duplicate(full_test_name);
+		new_entry.duration_us = duration_us;
+		vec_push(progress->new_entries, new_entry);
+	}
+
+	progress->num_done++;
+	if (!test_passed) {
+		progress->num_failed++;
+	}
+	redraw_progress(progress, full_test_name, !test_passed);
+}
+
+static void progress_skip_test(rktest_progress_t* progress, const rktest_test_t* test) {
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	format_full_test_name(full_test_name, sizeof(full_test_name), test);
+	const rktest_duration_entry_t* entry = find_duration_entry(progress->history, full_test_name);
+	if (entry) {
+		progress->remaining_known_us -= entry->duration_us < progress->remaining_known_us ? entry->duration_us : progress->remaining_known_us;
+	} else {
+		progress->remaining_unknown--;
+	}
+	progress->num_done++;
+	redraw_progress(progress, full_test_name, false);
+}
+
+static void finish_progress(rktest_progress_t* progress) {
+	clear_progress();
+	char durations_path[RKTEST_MAX_PATH_LENGTH + 16];
+	format_durations_path(durations_path, sizeof(durations_path));
+	save_test_durations(durations_path, progress);
+
+	if (progress->capture_file) {
+		fclose(progress->capture_file);
+	}
+	if (progress->saved_stdout_fd >= 0) {
+		rktest_close(progress->saved_stdout_fd);
+	}
+	vec_foreach(rktest_duration_entry_t*, entry, progress->history) {
+		free(entry->full_test_name);
+	}
+	vec_foreach(rktest_duration_entry_t*, entry, progress->new_entries) {
+		free(entry->full_test_name);
+	}
+	vec_free(progress->history);
+	vec_free(progress->new_entries);
+}
+
+/* ------------------------------- Histogram ------------------------------- */
+static int most_significant_bit(uint64_t value) {
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	int msb = 0;
+	while (value >>= 1) {
+		msb++;
+	}
+	return msb;
+#endif
+}
+
+static size_t histogram_bucket_index(uint64_t value) {
+	if (value < 2 * RKTEST_HISTOGRAM_SUB_BUCKETS) {
+		return (size_t)value;
+	}
+	const int shift = most_significant_bit(value) - RKTEST_HISTOGRAM_SUB_BUCKET_BITS;
+	return (size_t)shift * RKTEST_HISTOGRAM_SUB_BUCKETS + (size_t)(value >> shift);
+}
+
+static uint64_t histogram_bucket_lower_bound(size_t index) {
+	if (index < 2 * RKTEST_HISTOGRAM_SUB_BUCKETS) {
+		return index;
+	}
+	const size_t shift = index / RKTEST_HISTOGRAM_SUB_BUCKETS - 1;
+	return (uint64_t)(index - shift * RKTEST_HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+static uint64_t histogram_bucket_upper_bound(size_t index) {
+	if (index < 2 * RKTEST_HISTOGRAM_SUB_BUCKETS) {
+		return index;
+	}
+	const size_t shift = index / RKTEST_HISTOGRAM_SUB_BUCKETS - 1;
+	return histogram_bucket_lower_bound(index) + (((uint64_t)1 << shift) - 1);
+}
+
+static rktest_histogram_t histogram_new(void) {
+	rktest_histogram_t histogram = { 0 };
+	histogram.counts = calloc(RKTEST_HISTOGRAM_NUM_BUCKETS, sizeof(uint64_t));
+	histogram.min = UINT64_MAX;
+	return histogram;
+}
+
+static void histogram_free(rktest_histogram_t* histogram) {
+	free(histogram->counts);
+	histogram->counts = NULL;
+}
+
+static void histogram_record(rktest_histogram_t* histogram, uint64_t value, uint64_t count) {
+	histogram->counts[histogram_bucket_index(value)] += count;
+	histogram->total_count += count;
+	histogram->sum += (double)value * (double)count;
+	if (value < histogram->min) {
+		histogram->min = value;
+	}
+	if (value > histogram->max) {
+		histogram->max = value;
+	}
+}
+
+static void histogram_merge(rktest_histogram_t* histogram, const rktest_histogram_t* other) {
+	for (size_t i = 0; i < RKTEST_HISTOGRAM_NUM_BUCKETS; i++) {
+		histogram->counts[i] += other->counts[i];
+	}
+	histogram->total_count += other->total_count;
+	histogram->sum += other->sum;
+	if (other->min < histogram->min) {
+		histogram->min = other->min;
+	}
+	if (other->max > histogram->max) {
+		histogram->max = other->max;
+	}
+}
+
+static double histogram_mean(const rktest_histogram_t* histogram) {
+	return histogram->total_count > 0 ? histogram->sum / (double)histogram->total_count : 0.0;
+}
+
+// Returns the highest value equivalent to the given percentile, i.e. the upper
+// bound of the bucket it falls in, clamped to the recorded range.
+static uint64_t histogram_percentile(const rktest_histogram_t* histogram, double percentile) {
+	if (histogram->total_count == 0) {
+		return 0;
+	}
+	uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)histogram->total_count);
+	if (rank < 1) {
+		rank = 1;
+	}
+
+	uint64_t cumulative_count = 0;
+	for (size_t i = 0; i < RKTEST_HISTOGRAM_NUM_BUCKETS; i++) {
+		cumulative_count += histogram->counts[i];
+		if (cumulative_count >= rank) {
+			const uint64_t value = histogram_bucket_upper_bound(i);
+			if (value < histogram->min) {
+				return histogram->min;
+			}
+			return value < histogram->max ? value : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+/* ------------------------------- Benchmarks ------------------------------ */
+// Records `count` iterations that ended at `now`, excluding any paused time.
+static void bench_record(rktest_bench_t* bench, rktest_nanos_t now, size_t count) {
+	const rktest_nanos_t elapsed_ns = now - bench->last_ns;
+	const rktest_nanos_t timed_ns = elapsed_ns > bench->paused_ns ? elapsed_ns - bench->paused_ns : 0;
+	histogram_record(&bench->histogram, timed_ns / count, count);
+	bench->num_iterations += count;
+	bench->end_ns = now;
+	bench->paused_ns = 0;
+}
+
+// Open-loop variant of rktest_bench_loop(), where iteration `i` is scheduled to
+// start at `start_ns + i / ops_per_sec`. If we're ahead of schedule we wait, and
+// if we're behind we start right away, with the delay counted as latency.
+static bool bench_loop_paced(rktest_bench_t* bench) {
+	rktest_nanos_t now = rktest_clock_nanos();
+	pause_perf_counting();
+	if (!bench->is_running) {
+		bench->is_running = true;
+		bench->start_ns = now;
+	} else {
+		bench_record(bench, now, 1);
+	}
+
+	if (now - bench->start_ns >= bench->min_time_ns && bench->num_iterations > 0) {
+		bench->is_running = false;
+		return false;
+	}
+
+	const rktest_nanos_t scheduled_start = bench->start_ns + (rktest_nanos_t)((double)bench->num_iterations * 1e9 / bench->ops_per_sec);
+	while (now < scheduled_start) {
+		now = rktest_clock_nanos();
+	}
+	bench->last_ns = scheduled_start;
+	resume_perf_counting();
+	return true;
+}
+
+bool rktest_bench_loop(rktest_bench_t* bench) {
+	if (bench->ops_per_sec > 0.0) {
+		return bench_loop_paced(bench);
+	}
+
+	if (bench->batch_remaining > 0) {
+		bench->batch_remaining--;
+		return true;
+	}
+
+	const rktest_nanos_t now = rktest_clock_nanos();
+	if (!bench->is_running) {
+		bench->is_running = true;
+		bench->start_ns = now;
+		resume_perf_counting();
+	} else {
+		bench_record(bench, now, bench->batch_size);
+	}
+
+	if (now - bench->start_ns >= bench->min_time_ns && bench->num_iterations > 0) {
+		pause_perf_counting();
+		bench->is_running = false;
+		return false;
+	}
+
+	bench->batch_remaining = bench->batch_size - 1;
+	bench->last_ns = now;
+	return true;
+}
+
+void rktest_bench_set_batch_size(rktest_bench_t* bench, size_t batch_size) {
+	bench->batch_size = batch_size > 0 ? batch_size : 1;
+}
+
+void rktest_bench_pause(rktest_bench_t* bench) {
+	if (!bench->is_paused) {
+		bench->is_paused = true;
+		bench->pause_start_ns = rktest_clock_nanos();
+		pause_perf_counting();
+	}
+}
+
+void rktest_bench_resume(rktest_bench_t* bench) {
+	if (bench->is_paused) {
+		bench->is_paused = false;
+		if (bench->is_running) {
+			resume_perf_counting();
+		}
+		bench->paused_ns += rktest_clock_nanos() - bench->pause_start_ns;
+	}
+}
+
+// Ends the timing of the previous batch, if any, and returns whether another
+// batch of `batch_size` iterations should be prepared. The clock is stopped
+// until rktest_bench_batch_start().
+bool rktest_bench_batch_setup(rktest_bench_t* bench, size_t batch_size) {
+	const rktest_nanos_t now = rktest_clock_nanos();
+	pause_perf_counting();
+	if (!bench->is_running) {
+		bench->is_running = true;
+		bench->start_ns = now;
+	} else if (bench->is_batch_timed) {
+		bench_record(bench, now, bench->batch_size);
+	}
+	bench->is_batch_timed = false;
+
+	if (now - bench->start_ns >= bench->min_time_ns) {
+		if (bench->num_iterations == 0) {
+			printf("error: rktest_bench_batch_start() was never called after rktest_bench_batch_setup()\n");
+			bench->is_failed = true;
+		}
+		bench->is_running = false;
+		return false;
+	}
+
+	bench->batch_size = batch_size > 0 ? batch_size : 1;
+	return true;
+}
+
+void rktest_bench_batch_start(rktest_bench_t* bench) {
+	bench->is_batch_timed = true;
+	bench->paused_ns = 0;
+	resume_perf_counting();
+	bench->last_ns = rktest_clock_nanos();
+}
+
+int64_t rktest_bench_arg(const rktest_bench_t* bench) {
+	return bench->arg;
+}
+
+// Returns a buffer at the current alignment offset from a page boundary. It is
+// freed once the benchmark body returns.
+void* rktest_bench_buffer(rktest_bench_t* bench, size_t size) {
+	char* allocation = malloc(size + RKTEST_BENCH_BUFFER_ALIGNMENT + RKTEST_ALIGNMENT_SWEEP_NUM_OFFSETS);
+	if (!allocation) {
+		return NULL;
+	}
+	vec_push(bench->buffers, allocation);
+	bench->num_buffers++;
+
+	const uintptr_t alignment_mask = RKTEST_BENCH_BUFFER_ALIGNMENT - 1;
+	const uintptr_t page_start = ((uintptr_t)allocation + alignment_mask) & ~alignment_mask;
+	return allocation + (page_start - (uintptr_t)allocation) + bench->alignment_offset;
+}
+
+/* ---------------------------- Benchmark memory ---------------------------- */
+#ifdef __linux__
+static size_t read_huge_page_size(void) {
+	FILE* meminfo = fopen("/proc/meminfo", "r");
+	if (!meminfo) {
+		return RKTEST_DEFAULT_HUGE_PAGE_SIZE;
+	}
+	char line[256];
+	size_t huge_page_size_kb = 0;
+	while (fgets(line, sizeof(line), meminfo)) {
+		if (sscanf(line, "Hugepagesize: %zu kB", &huge_page_size_kb) == 1) {
+			break;
+		}
+	}
+	fclose(meminfo);
+	return huge_page_size_kb > 0 ? huge_page_size_kb * 1024 : RKTEST_DEFAULT_HUGE_PAGE_SIZE;
+}
+
+// Returns how much of the mapping containing `address` is backed by transparent
+// huge pages, according to /proc/self/smaps
+static size_t read_anon_huge_page_bytes(const void* address) {
+	FILE* smaps = fopen("/proc/self/smaps", "r");
+	if (!smaps) {
+		return 0;
+	}
+	char line[512];
+	bool is_in_mapping = false;
+	size_t huge_kb = 0;
+	while (fgets(line, sizeof(line), smaps)) {
+		unsigned long start = 0;
+		unsigned long end = 0;
+		size_t kb = 0;
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			is_in_mapping = start <= (uintptr_t)address && (uintptr_t)address < end;
+		} else if (is_in_mapping && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+			huge_kb += kb;
+		}
+	}
+	fclose(smaps);
+	return huge_kb * 1024;
+}
+
+static size_t round_up_to(size_t size, size_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+// Maps the memory of `allocation` according to `flags`, falling back to normal
+// pages for anything that is not available. Returns false if mmap() failed.
+static bool map_bench_allocation(rktest_bench_allocation_t* allocation, int flags) {
+	const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t huge_page_size = read_huge_page_size();
+	const int numa_node = (flags >> 8) - 1;
+	char* address = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if (flags & RKTEST_ALLOC_HUGETLB) {
+		allocation->mapping_size = round_up_to(allocation->size, huge_page_size);
+		address = mmap(NULL, allocation->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (address != MAP_FAILED) {
+			allocation->page_size = huge_page_size;
+			allocation->is_hugetlb = true;
+		} else {
+			rktest_printf_yellow("Warning: no hugetlbfs pages available, falling back to normal pages\n");
+		}
+	}
+#endif
+
+	/* Pages can only be populated by mmap() if nothing needs to be set up before they are faulted in */
+	bool is_populated = false;
+	if (address == MAP_FAILED) {
+		allocation->page_size = page_size;
+		allocation->mapping_size = round_up_to(allocation->size, page_size);
+		const bool wants_huge_pages = (flags & RKTEST_ALLOC_HUGE_PAGES) != 0;
+		const size_t map_size = allocation->mapping_size + (wants_huge_pages ? huge_page_size : 0);
+		int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+		if ((flags & RKTEST_ALLOC_PREFAULT) && !wants_huge_pages && numa_node < 0) {
+			map_flags |= MAP_POPULATE;
+			is_populated = true;
+		}
+#endif
+		address = mmap(NULL, map_size, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+		if (address == MAP_FAILED) {
+			return false;
+		}
+
+		if (wants_huge_pages) {
+			/* Trim the mapping to start on a huge page boundary, so that it can be backed by huge pages */
+			char* aligned_address = (char*)round_up_to((uintptr_t)address, huge_page_size);
+			const size_t head_size = (size_t)(aligned_address - address);
+			const size_t tail_size = map_size - head_size - allocation->mapping_size;
+			if (head_size > 0) {
+				munmap(address, head_size);
+			}
+			if (tail_size > 0) {
+				munmap(aligned_address + allocation->mapping_size, tail_size);
+			}
+			address = aligned_address;
+#ifdef MADV_HUGEPAGE
+			if (madvise(address, allocation->mapping_size, MADV_HUGEPAGE) != 0) {
+				rktest_printf_yellow("Warning: transparent huge pages are not available\n");
+			}
+#endif
+		}
+	}
+	allocation->address = address;
+
+	if (numa_node >= 0) {
+#ifdef SYS_mbind
+		const unsigned long node_mask = numa_node < (int)(sizeof(unsigned long) * 8) ? 1ul << numa_node : 0;
+		if (!node_mask || syscall(SYS_mbind, address, allocation->mapping_size, RKTEST_MPOL_BIND, &node_mask, sizeof(node_mask) * 8, 0) != 0) {
+			rktest_printf_yellow("Warning: could not bind memory to NUMA node %d\n", numa_node);
+		}
+#endif
+	}
+
+	if ((flags & RKTEST_ALLOC_PREFAULT) && !is_populated) {
+		for (size_t offset = 0; offset < allocation->mapping_size; offset += allocation->page_size) {
+			((volatile char*)address)[offset] = 0;
+		}
+	}
+	return true;
+}
+#endif // __linux__
+
+void* rktest_bench_alloc(rktest_bench_t* bench, size_t size, int flags) {
+	rktest_bench_allocation_t allocation = { 0 };
+	allocation.size = size;
+#ifdef __linux__
+	if (!map_bench_allocation(&allocation, flags)) {
+		allocation = (rktest_bench_allocation_t){ 0 };
+		allocation.size = size;
+	}
+#endif
+	if (!allocation.address) {
+		allocation.address = malloc(size);
+		if (!allocation.address) {
+			return NULL;
+		}
+		if (flags & RKTEST_ALLOC_PREFAULT) {
+			memset(allocation.address, 0, size);
+		}
+	}
+	vec_push(bench->allocations, allocation);
+	return allocation.address;
+}
+
+// Frees the rktest_bench_alloc() memory, recording how much of it turned out
+// to be backed by huge pages now that the benchmark has touched it.
+static void free_bench_allocations(rktest_bench_t* bench) {
+	vec_foreach(rktest_bench_allocation_t*, allocation, bench->allocations) {
+		bench->allocated_bytes += allocation->size;
+		if (!allocation->mapping_size) {
+			free(allocation->address);
+			continue;
+		}
+#ifdef __linux__
+		size_t huge_bytes = 0;
+		size_t huge_page_size = allocation->page_size;
+		if (allocation->is_hugetlb) {
+			huge_bytes = allocation->size;
+		} else {
+			huge_bytes = read_anon_huge_page_bytes(allocation->address);
+			huge_bytes = huge_bytes < allocation->size ? huge_bytes : allocation->size;
+			huge_page_size = huge_bytes > 0 ? read_huge_page_size() : 0;
+		}
+		bench->huge_page_bytes += huge_bytes;
+		if (huge_page_size > bench->huge_page_size && huge_bytes > 0) {
+			bench->huge_page_size = huge_page_size;
+		}
+		munmap(allocation->address, allocation->mapping_size);
+#endif
+	}
+	vec_free(bench->allocations);
+}
+
+static void format_nanos(char* buf, size_t buf_size, double ns) {
+	if (ns < 1e3) {
+		snprintf(buf, buf_size, "%.1f ns", ns);
+	} else if (ns < 1e6) {
+		snprintf(buf, buf_size, "%.2f us", ns / 1e3);
+	} else if (ns < 1e9) {
+		snprintf(buf, buf_size, "%.2f ms", ns / 1e6);
+	} else {
+		snprintf(buf, buf_size, "%.2f s", ns / 1e9);
+	}
+}
+
+static double bench_achieved_ops_per_sec(const rktest_bench_t* bench) {
+	const rktest_nanos_t elapsed_ns = bench->end_ns - bench->start_ns;
+	return elapsed_ns > 0 ? (double)bench->num_iterations * 1e9 / (double)elapsed_ns : 0.0;
+}
+
+static void print_benchmark_result(const rktest_bench_t* bench) {
+	const rktest_histogram_t* histogram = &bench->histogram;
+	const double values[] = {
+		histogram_mean(histogram),
+		(double)histogram_percentile(histogram, 50.0),
+		(double)histogram_percentile(histogram, 90.0),
+		(double)histogram_percentile(histogram, 99.0),
+		(double)histogram_percentile(histogram, 99.9),
+		(double)histogram->max,
+	};
+	const char* labels[] = { "mean", "p50", "p90", "p99", "p99.9", "max" };
+	const size_t num_values = sizeof(values) / sizeof(values[0]);
+
+	if (bench->ops_per_sec > 0.0) {
+		printf("             target %.0f ops/s, achieved %.0f ops/s\n", bench->ops_per_sec, bench_achieved_ops_per_sec(bench));
+	}
+	printf("             %llu iterations:", (unsigned long long)bench->num_iterations);
+	for (size_t i = 0; i < num_values; i++) {
+		char value_str[32];
+		format_nanos(value_str, sizeof(value_str), values[i]);
+		printf(" %s %s%s", labels[i], value_str, i + 1 < num_values ? "," : "");
+	}
+	printf("\n");
+	if (bench->allocated_bytes > 0) {
+		printf("             %.1f MiB allocated, ", (double)bench->allocated_bytes / (1 << 20));
+		if (bench->huge_page_bytes > 0) {
+			printf("%.1f MiB of it in %zu KiB huge pages\n", (double)bench->huge_page_bytes / (1 << 20), bench->huge_page_size / 1024);
+		} else {
+			printf("none of it in huge pages\n");
+		}
+	}
+}
+
+static void write_benchmark_json(rktest_benchmark_json_t* json, const char* name, const rktest_bench_t* bench) {
+	FILE* file = json->file;
+	if (!file) {
+		return;
+	}
+	const rktest_histogram_t* histogram = &bench->histogram;
+	fprintf(file, "%s\n    {\n", json->num_entries == 0 ? "" : ",");
+	json->num_entries++;
+	fprintf(file, "      \"name\": \"%s\",\n", name);
+	fprintf(file, "      \"iterations\": %llu,\n", (unsigned long long)bench->num_iterations);
+	if (bench->ops_per_sec > 0.0) {
+		fprintf(file, "      \"target_ops_per_sec\": %.3f,\n", bench->ops_per_sec);
+		fprintf(file, "      \"achieved_ops_per_sec\": %.3f,\n", bench_achieved_ops_per_sec(bench));
+	}
+	if (bench->allocated_bytes > 0) {
+		fprintf(file, "      \"allocated_bytes\": %llu,\n", (unsigned long long)bench->allocated_bytes);
+		fprintf(file, "      \"huge_page_bytes\": %llu,\n", (unsigned long long)bench->huge_page_bytes);
+		fprintf(file, "      \"huge_page_size\": %zu,\n", bench->huge_page_size);
+	}
+	fprintf(file, "      \"mean_ns\": %.3f,\n", histogram_mean(histogram));
+	fprintf(file, "      \"min_ns\": %llu,\n", (unsigned long long)(histogram->total_count > 0 ? histogram->min : 0));
+	fprintf(file, "      \"p50_ns\": %llu,\n", (unsigned long long)histogram_percentile(histogram, 50.0));
+	fprintf(file, "      \"p90_ns\": %llu,\n", (unsigned long long)histogram_percentile(histogram, 90.0));
+	fprintf(file, "      \"p99_ns\": %llu,\n", (unsigned long long)histogram_percentile(histogram, 99.0));
+	fprintf(file, "      \"p999_ns\": %llu,\n", (unsigned long long)histogram_percentile(histogram, 99.9));
+	fprintf(file, "      \"max_ns\": %llu,\n", (unsigned long long)histogram->max);
+
+	/* Only non-empty buckets, as [lower_bound_ns, upper_bound_ns, count] */
+	fprintf(file, "      \"histogram\": [");
+	bool is_first_bucket = true;
+	for (size_t i = 0; i < RKTEST_HISTOGRAM_NUM_BUCKETS; i++) {
+		if (histogram->counts[i] == 0) {
+			continue;
+		}
+		fprintf(
+			file,
+			"%s[%llu, %llu, %llu]",
+			is_first_bucket ? "" : ", ",
+			(unsigned long long)histogram_bucket_lower_bound(i),
+			(unsigned long long)histogram_bucket_upper_bound(i),
+			(unsigned long long)histogram->counts[i]
+		);
+		is_first_bucket = false;
+	}
+	fprintf(file, "]\n    }");
+}
+
+/* ----------------------- Instruction set levels ------------------------ */
+static const char* const g_isa_names[RKTEST_ISA_COUNT] = { "scalar", "sse4.2", "avx2", "avx512" };
+static rktest_isa_t g_current_isa = RKTEST_ISA_SCALAR;
+
+rktest_isa_t rktest_current_isa(void) {
+	return g_current_isa;
+}
+
+static bool isa_is_supported(rktest_isa_t isa) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	switch (isa) {
+		case RKTEST_ISA_SSE42:
+			return __builtin_cpu_supports("sse4.2");
+		case RKTEST_ISA_AVX2:
+			return __builtin_cpu_supports("avx2");
+		case RKTEST_ISA_AVX512:
+			return __builtin_cpu_supports("avx512f");
+		default:
+			break;
+	}
+#endif
+	return isa == RKTEST_ISA_SCALAR;
+}
+
+/* ------------------------- RKTest implementation ------------------------- */
+static void print_usage(void) {
+	printf("\n");
+	printf("This program is a unit test runner built using RK Test.\n");
+	printf("\n");
+	printf("Usage:\n");
+	printf("\n");
+	printf("  --rktest_color=(yes|no|auto)\n");
+	printf("    Enable/disable colored output. The default is auto.\n");
+	printf("\n");
+	printf("  --rktest_filter=PATTERN\n");
+	printf("    Run only the tests that matches the globbing pattern. * matches against\n");
+	printf("    any number of characters, and ? matches any single character.\n");
+	printf("\n");
+	printf("  --rktest_print_time=0\n");
+	printf("    Disable printing out the elapsed time for test cases and test suites.\n");
+	printf("\n");
+	printf("  --rktest_print_filenames=0\n");
+	printf("    Disable printing out the filename of a test case on assert failure.\n");
+	printf("\n");
+	printf("  --rktest_p_value=P\n");
+	printf("    Fail statistical assertions with a p-value below P. The default is 0.001.\n");
+	printf("\n");
+	printf("  --rktest_progress=(yes|no|auto)\n");
+	printf("    Show a single status line with progress and time left instead of the\n");
+	printf("    output of each test. Output is only printed for failing tests.\n");
+	printf("    The default is no.\n");
+	printf("\n");
+	printf("  --rktest_oom_sweep=PATTERN\n");
+	printf("    Fail each allocation of the tests matching the globbing pattern, one at\n");
+	printf("    a time, and report allocation failures that crash or leak memory.\n");
+	printf("\n");
+	printf("  --rktest_isa_max=(scalar|sse4.2|avx2|avx512)\n");
+	printf("    Run TEST_ISA() tests only up to the given instruction set level.\n");
+	printf("    The default is every level supported by the machine.\n");
+	printf("\n");
+	printf("  --rktest_cache_dir=DIR\n");
+	printf("    Directory of the data cached by rktest_cached_data() and of the test\n");
+	printf("    durations of the progress line. The default is <executable>.cache, or\n");
+	printf("    rktest-<executable>.cache in the temp directory if it is read-only.\n");
+	printf("\n");
+	printf("  --rktest_data_dir=DIR\n");
+	printf("    Directory that relative TEST_DATA() paths are resolved against. The default\n");
+	printf("    is RKTEST_DATA_DIR if defined, else the directory of the source file.\n");
+	printf("\n");
+	printf("  --rktest_jobs=N\n");
+	printf("    Run the test suites in N worker processes. The default is 1.\n");
+	printf("\n");
+	printf("  --rktest_shards=N\n");
+	printf("    Split every TEST_DATA() and TEST_INDEXED() into N instances running\n");
+	printf("    every Nth record or a contiguous Nth of the indices. The default is 1.\n");
+	printf("\n");
+	printf("  --rktest_pipeline_fixtures=(yes|no)\n");
+	printf("    Run independent suite setups of the next suite while the current suite\n");
+	printf("    runs, and independent suite teardowns in the background. Ignored with\n");
+	printf("    --rktest_oom_sweep, --rktest_leak_check and --rktest_jobs. The default is no.\n");
+	printf("\n");
+	printf("  --rktest_benchmark=PATTERN\n");
+	printf("    Run the benchmarks that matches the globbing pattern instead of tests.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_min_time=SECONDS\n");
+	printf("    Run each benchmark loop for at least this many seconds. The default is 0.5.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_repetitions=N\n");
+	printf("    Run each benchmark N times. The default is 1.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_rate_sweep=(yes|no)\n");
+	printf("    Run rate benchmarks at doubling rates until saturated. The default is no.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_alignment_sweep=STRIDE\n");
+	printf("    Run benchmarks with their buffers at every STRIDE bytes offset from 0 to 63.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_isolation=(none|process)\n");
+	printf("    Run each benchmark repetition in a forked child process. The default is none.\n");
+	printf("\n");
+	printf("  --rktest_benchmark_json=FILE\n");
+	printf("    Write benchmark results and latency histograms as JSON to FILE.\n");
+	printf("\n");
+	printf("  --rktest_leak_check=(off|report|fail)\n");
+	printf("    Report (or fail tests on) file descriptors and threads leaked by a test.\n");
+	printf("    Only supported on Linux. The default is off.\n");
+	printf("\n");
+	printf("  --rktest_perf_counters=(off|instructions|caches)\n");
+	printf("    Count retired instructions (and cache misses) per test and benchmark\n");
+	printf("    iteration. Only supported on Linux. The default is off.\n");
+	printf("\n");
+	printf("  --rktest_perf_save=FILE\n");
+	printf("    Save the counts to FILE as a baseline for later runs.\n");
+	printf("\n");
+	printf("  --rktest_perf_baseline=FILE\n");
+	printf("    Fail when retiring more instructions than the baseline in FILE.\n");
+	printf("\n");
+	printf("  --rktest_perf_threshold=PERCENT\n");
+	printf("    Allowed instruction count growth over the baseline. The default is 1.\n");
+}
+
+static rktest_config_t parse_args(int argc, const char* argv[]) {
+	rktest_config_t config = (rktest_config_t) { 0 };
+	config.color_mode = RKTEST_COLOR_MODE_AUTO;
+	config.print_timestamps_enabled = true;
+	config.benchmark_min_time_s = RKTEST_DEFAULT_BENCHMARK_MIN_TIME_S;
+	config.benchmark_repetitions = 1;
+	config.perf_threshold_percent = RKTEST_DEFAULT_PERF_THRESHOLD_PERCENT;
+	config.isa_max = (rktest_isa_t)(RKTEST_ISA_COUNT - 1);
+	config.jobs = 1;
+	config.shards = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+			print_usage();
+			exit(1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_color=")) {
+			if (strcmp(arg + strlen("--rktest_color="), "yes") == 0) {
+				config.color_mode = RKTEST_COLOR_MODE_ON;
+			} else if (strcmp(arg + strlen("--rktest_color="), "no") == 0) {
+				config.color_mode = RKTEST_COLOR_MODE_OFF;
+			} else if (strcmp(arg + strlen("--rktest_color="), "auto") == 0) {
+				config.color_mode = RKTEST_COLOR_MODE_AUTO;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_filter=")) {
+			const char* filter_pattern = arg + strlen("--rktest_filter=");
+			const size_t filter_len = strlen(filter_pattern);
+			if (filter_len > RKTEST_MAX_FILTER_LENGTH) {
+				fprintf(stderr, "Error: filter pattern too long. Max length is (%d)", RKTEST_MAX_FILTER_LENGTH);
+				fprintf(stderr, "filter pattern = \"%s\"", filter_pattern);
+				exit(1);
+			}
+			strncpy(config.test_filter, filter_pattern, filter_len);
+		}
+
+		else if (string_starts_with(arg, "--rktest_print_time=")) {
+			if (strcmp(arg + strlen("--rktest_print_time="), "0") == 0) {
+				config.print_timestamps_enabled = false;
+			} else {
+				config.print_timestamps_enabled = true;
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_print_filenames=")) {
+			if (strcmp(arg + strlen("--rktest_print_filenames="), "0") == 0) {
+				g_filenames_enabled = false;
+			} else {
+				g_filenames_enabled = true;
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_oom_sweep=")) {
+			const char* sweep_pattern = arg + strlen("--rktest_oom_sweep=");
+			const size_t sweep_pattern_len = strlen(sweep_pattern);
+			if (sweep_pattern_len >= RKTEST_MAX_FILTER_LENGTH) {
+				fprintf(stderr, "Error: OOM sweep pattern too long. Max length is (%d)\n", RKTEST_MAX_FILTER_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(config.oom_sweep_filter, sweep_pattern, sweep_pattern_len);
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark=")) {
+			const char* benchmark_pattern = arg + strlen("--rktest_benchmark=");
+			const size_t benchmark_pattern_len = strlen(benchmark_pattern);
+			if (benchmark_pattern_len >= RKTEST_MAX_FILTER_LENGTH) {
+				fprintf(stderr, "Error: benchmark pattern too long. Max length is (%d)\n", RKTEST_MAX_FILTER_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(config.benchmark_filter, benchmark_pattern, benchmark_pattern_len);
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_min_time=")) {
+			char* end = NULL;
+			config.benchmark_min_time_s = strtod(arg + strlen("--rktest_benchmark_min_time="), &end);
+			if (*end != '\0' || config.benchmark_min_time_s < 0.0) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_repetitions=")) {
+			char* end = NULL;
+			const long repetitions = strtol(arg + strlen("--rktest_benchmark_repetitions="), &end, 10);
+			if (*end != '\0' || repetitions < 1) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+			config.benchmark_repetitions = (size_t)repetitions;
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_rate_sweep=")) {
+			if (strcmp(arg + strlen("--rktest_benchmark_rate_sweep="), "yes") == 0) {
+				config.benchmark_rate_sweep_enabled = true;
+			} else if (strcmp(arg + strlen("--rktest_benchmark_rate_sweep="), "no") == 0) {
+				config.benchmark_rate_sweep_enabled = false;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_alignment_sweep=")) {
+			char* end = NULL;
+			const long stride = strtol(arg + strlen("--rktest_benchmark_alignment_sweep="), &end, 10);
+			if (*end != '\0' || stride < 1 || stride > RKTEST_ALIGNMENT_SWEEP_NUM_OFFSETS) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+			config.benchmark_alignment_stride = (size_t)stride;
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_isolation=")) {
+			if (strcmp(arg + strlen("--rktest_benchmark_isolation="), "none") == 0) {
+				config.benchmark_isolation = RKTEST_BENCHMARK_ISOLATION_NONE;
+			} else if (strcmp(arg + strlen("--rktest_benchmark_isolation="), "process") == 0) {
+				config.benchmark_isolation = RKTEST_BENCHMARK_ISOLATION_PROCESS;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_benchmark_json=")) {
+			const char* json_path = arg + strlen("--rktest_benchmark_json=");
+			if (strlen(json_path) >= RKTEST_MAX_PATH_LENGTH) {
+				fprintf(stderr, "Error: benchmark json path too long. Max length is (%d)\n", RKTEST_MAX_PATH_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(config.benchmark_json_path, json_path, RKTEST_MAX_PATH_LENGTH - 1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_cache_dir=")) {
+			const char* cache_dir = arg + strlen("--rktest_cache_dir=");
+			if (strlen(cache_dir) >= RKTEST_MAX_PATH_LENGTH) {
+				fprintf(stderr, "Error: cache directory path too long. Max length is (%d)\n", RKTEST_MAX_PATH_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(g_cache_dir, cache_dir, RKTEST_MAX_PATH_LENGTH - 1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_data_dir=")) {
+			const char* data_dir = arg + strlen("--rktest_data_dir=");
+			if (strlen(data_dir) >= RKTEST_MAX_PATH_LENGTH) {
+				fprintf(stderr, "Error: data directory path too long. Max length is (%d)\n", RKTEST_MAX_PATH_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(g_data_dir, data_dir, RKTEST_MAX_PATH_LENGTH - 1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_jobs=")) {
+			char* end = NULL;
+			const long jobs = strtol(arg + strlen("--rktest_jobs="), &end, 10);
+			if (*end != '\0' || jobs < 1) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+			config.jobs = (size_t)jobs;
+		}
+
+		/* --rktest_data_shards is the former name of --rktest_shards */
+		else if (string_starts_with(arg, "--rktest_shards=") || string_starts_with(arg, "--rktest_data_shards=")) {
+			char* end = NULL;
+			const long shards = strtol(strchr(arg, '=') + 1, &end, 10);
+			if (*end != '\0' || shards < 1) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+			config.shards = (size_t)shards;
+		}
+
+		else if (string_starts_with(arg, "--rktest_pipeline_fixtures=")) {
+			if (strcmp(arg + strlen("--rktest_pipeline_fixtures="), "yes") == 0) {
+				config.pipeline_fixtures_enabled = true;
+			} else if (strcmp(arg + strlen("--rktest_pipeline_fixtures="), "no") == 0) {
+				config.pipeline_fixtures_enabled = false;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_isa_max=")) {
+			int isa = RKTEST_ISA_SCALAR;
+			while (isa < RKTEST_ISA_COUNT && strcmp(arg + strlen("--rktest_isa_max="), g_isa_names[isa]) != 0) {
+				isa++;
+			}
+			if (isa == RKTEST_ISA_COUNT) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+			config.isa_max = (rktest_isa_t)isa;
+		}
+
+		else if (string_starts_with(arg, "--rktest_p_value=")) {
+			char* end = NULL;
+			g_p_value_threshold = strtod(arg + strlen("--rktest_p_value="), &end);
+			if (*end != '\0' || g_p_value_threshold <= 0.0 || g_p_value_threshold >= 1.0) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_progress=")) {
+			if (strcmp(arg + strlen("--rktest_progress="), "yes") == 0) {
+				config.progress_enabled = true;
+			} else if (strcmp(arg + strlen("--rktest_progress="), "no") == 0) {
+				config.progress_enabled = false;
+			} else if (strcmp(arg + strlen("--rktest_progress="), "auto") == 0) {
+				config.progress_enabled = rktest_isatty(rktest_fileno(stdout));
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_leak_check=")) {
+			if (strcmp(arg + strlen("--rktest_leak_check="), "off") == 0) {
+				config.leak_check_mode = RKTEST_LEAK_CHECK_OFF;
+			} else if (strcmp(arg + strlen("--rktest_leak_check="), "report") == 0) {
+				config.leak_check_mode = RKTEST_LEAK_CHECK_REPORT;
+			} else if (strcmp(arg + strlen("--rktest_leak_check="), "fail") == 0) {
+				config.leak_check_mode = RKTEST_LEAK_CHECK_FAIL;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_perf_counters=")) {
+			if (strcmp(arg + strlen("--rktest_perf_counters="), "off") == 0) {
+				config.perf_counters_mode = RKTEST_PERF_COUNTERS_OFF;
+			} else if (strcmp(arg + strlen("--rktest_perf_counters="), "instructions") == 0) {
+				config.perf_counters_mode = RKTEST_PERF_COUNTERS_INSTRUCTIONS;
+			} else if (strcmp(arg + strlen("--rktest_perf_counters="), "caches") == 0) {
+				config.perf_counters_mode = RKTEST_PERF_COUNTERS_CACHES;
+			} else {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else if (string_starts_with(arg, "--rktest_perf_save=")) {
+			const char* perf_save_path = arg + strlen("--rktest_perf_save=");
+			if (strlen(perf_save_path) >= RKTEST_MAX_PATH_LENGTH) {
+				fprintf(stderr, "Error: perf save path too long. Max length is (%d)\n", RKTEST_MAX_PATH_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(config.perf_save_path, perf_save_path, RKTEST_MAX_PATH_LENGTH - 1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_perf_baseline=")) {
+			const char* perf_baseline_path = arg + strlen("--rktest_perf_baseline=");
+			if (strlen(perf_baseline_path) >= RKTEST_MAX_PATH_LENGTH) {
+				fprintf(stderr, "Error: perf baseline path too long. Max length is (%d)\n", RKTEST_MAX_PATH_LENGTH - 1);
+				exit(1);
+			}
+			strncpy(config.perf_baseline_path, perf_baseline_path, RKTEST_MAX_PATH_LENGTH - 1);
+		}
+
+		else if (string_starts_with(arg, "--rktest_perf_threshold=")) {
+			char* end = NULL;
+			config.perf_threshold_percent = strtod(arg + strlen("--rktest_perf_threshold="), &end);
+			if (*end != '\0' || config.perf_threshold_percent < 0.0) {
+				fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+				print_usage();
+				exit(1);
+			}
+		}
+
+		else {
+			fprintf(stderr, "Error: Unrecognized argument %s\n", arg);
+			print_usage();
+			exit(1);
+		}
+	}
+
+	return config;
+}
+
+#ifdef _MSC_VER
+static rktest_enable_vterm_result_t enable_windows_virtual_terminal(void) {
+	// Set output mode to handle virtual terminal sequences
+	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (hOut == INVALID_HANDLE_VALUE) {
+		return RKTEST_ENABLE_VTERM_ERROR_INVALID_HANDLE_VALUE;
+	}
+
+	DWORD dwMode = 0;
+	if (!GetConsoleMode(hOut, &dwMode)) {
+		return RKTEST_ENABLE_VTERM_ERROR_GET_CONSOLE_MODE_FAILED;
+	}
+
+	dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+	if (!SetConsoleMode(hOut, dwMode)) {
+		return RKTEST_ENABLE_VTERM_ERROR_ENABLE_VIRTUAL_TERMINAL_FAILED;
+	}
+
+	return RKTEST_ENABLE_VTERM_OK;
+}
+#endif // WIN32
+
+static rktest_config_t initialize(int argc, const char* argv[]) {
+	rktest_config_t config = parse_args(argc, argv);
+	snprintf(g_executable_path, sizeof(g_executable_path), "%s", argc > 0 ? argv[0] : "");
+
+	g_colors_enabled = true;
+	if (config.color_mode == RKTEST_COLOR_MODE_OFF) {
+		g_colors_enabled = false;
+	}
+
+#ifdef _MSC_VER
+	if (g_colors_enabled) {
+		switch (enable_windows_virtual_terminal()) {
+			case RKTEST_ENABLE_VTERM_ERROR_INVALID_HANDLE_VALUE:
+				g_colors_enabled = false;
+				fprintf(stderr, "Error: GetStdHandle returned INVALID_HANDLE_VALUE\n");
+				break;
+			case RKTEST_ENABLE_VTERM_ERROR_GET_CONSOLE_MODE_FAILED:
+				g_colors_enabled = false;
+				break;
+			case RKTEST_ENABLE_VTERM_ERROR_ENABLE_VIRTUAL_TERMINAL_FAILED:
+				g_colors_enabled = false;
+				fprintf(stderr, "Error: SetConsoleMode to ENABLE_VIRTUAL_TERMINAL_PROCESSING failed\n");
+				break;
+			case RKTEST_ENABLE_VTERM_OK:
+				break;
+		}
+	}
+#endif // WIN32
+
+#ifndef RKTEST_OOM_SWEEP_SUPPORTED
+	if (*config.oom_sweep_filter) {
+		fprintf(stderr, "Warning: --rktest_oom_sweep needs RK Test to be built with RKTEST_INTERPOSE_MALLOC on a glibc system\n");
+	}
+#endif
+
+#ifndef RKTEST_BENCHMARK_ISOLATION_SUPPORTED
+	if (config.benchmark_isolation != RKTEST_BENCHMARK_ISOLATION_NONE) {
+		fprintf(stderr, "Warning: --rktest_benchmark_isolation=process is not supported on Windows\n");
+		config.benchmark_isolation = RKTEST_BENCHMARK_ISOLATION_NONE;
+	}
+#endif
+
+#ifndef __linux__
+	if (config.leak_check_mode != RKTEST_LEAK_CHECK_OFF) {
+		fprintf(stderr, "Warning: --rktest_leak_check is only supported on Linux\n");
+		config.leak_check_mode = RKTEST_LEAK_CHECK_OFF;
+	}
+#endif
+
+	if ((*config.perf_save_path || *config.perf_baseline_path) && config.perf_counters_mode == RKTEST_PERF_COUNTERS_OFF) {
+		config.perf_counters_mode = RKTEST_PERF_COUNTERS_INSTRUCTIONS;
+	}
+
+#ifndef RKTEST_JOBS_SUPPORTED
+	if (config.jobs > 1) {
+		fprintf(stderr, "Warning: --rktest_jobs is not supported on Windows\n");
+		config.jobs = 1;
+	}
+#endif
+	if (config.jobs > 1 && config.perf_counters_mode != RKTEST_PERF_COUNTERS_OFF) {
+		fprintf(stderr, "Warning: --rktest_jobs is ignored when counting instructions\n");
+		config.jobs = 1;
+	}
+	if (config.jobs > 1) {
+		config.progress_enabled = false;
+	}
+	/* Background fixtures would allocate during the sweep or leak check of a
+	 * test, and print into the output captured for another worker's suite */
+	if (config.pipeline_fixtures_enabled && (*config.oom_sweep_filter || config.leak_check_mode != RKTEST_LEAK_CHECK_OFF || config.jobs > 1)) {
+		fprintf(stderr, "Warning: --rktest_pipeline_fixtures is ignored with --rktest_oom_sweep, --rktest_leak_check or --rktest_jobs\n");
+		config.pipeline_fixtures_enabled = false;
+	}
+
+	return config;
+}
+
+static rktest_suite_t* find_suite_with_name(vec_t(rktest_suite_t) suites, const char* suite_name) {
+	vec_foreach(rktest_suite_t*, suite, suites) {
+		if (strcmp(suite->name, suite_name) == 0) {
+			return suite;
+		}
+	}
+	return NULL;
+}
+
+static bool test_matches_pattern(const rktest_test_t* test, const char* pattern) {
+	char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+	format_full_test_name(full_test_name, sizeof(full_test_name), test);
+	return string_wildcard_match(full_test_name, pattern);
+}
+
+static bool test_matches_filter(const rktest_test_t* test, const char* pattern) {
+	if (*pattern == '\0') {
+		return true;
+	}
+	/* Subtests are matched against what follows a slash when they run */
+	const char* slash = strchr(pattern, '/');
+	if (slash) {
+		char test_pattern[RKTEST_MAX_FILTER_LENGTH];
+		snprintf(test_pattern, sizeof(test_pattern), "%.*s", (int)(slash - pattern), pattern);
+		return test_matches_pattern(test, test_pattern);
+	}
+	return test_matches_pattern(test, pattern);
+}
+
+/* --------------------------- Test dependencies --------------------------- */
+// Whether `test` is the test named `full_test_name`, or one of the TEST_ISA()
+// or shard instances, like `name[avx2]`, that the test is split into
+static bool is_instance_of(const rktest_test_t* test, const char* full_test_name) {
+	const size_t suite_name_length = strlen(test->suite_name);
+	if (strncmp(full_test_name, test->suite_name, suite_name_length) != 0 || full_test_name[suite_name_length] != '.') {
+		return false;
+	}
+	const char* test_name = full_test_name + suite_name_length + 1;
+	const size_t test_name_length = strlen(test_name);
+	if (strncmp(test->test_name, test_name, test_name_length) != 0) {
+		return false;
+	}
+	return test->test_name[test_name_length] == '\0' || test->test_name[test_name_length] == '[';
+}
+
+static bool is_registered_test(const char* full_test_name) {
+	for (size_t i = 0; i < get_num_test_definitions(); i++) {
+		const rktest_test_t* test = get_test_definition(i);
+		if (test == NULL || (!test->run && !test->run_record && !test->run_index && !test->run_with_context)) {
+			continue;
+		}
+		char name[RKTEST_MAX_TEST_NAME_LENGTH];
+		format_full_test_name(name, sizeof(name), test);
+		if (strcmp(name, full_test_name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Finds a stable topological order of `num_nodes` nodes, where node `i` comes
+// after the nodes `edges[edge_starts[i]]` to `edges[edge_starts[i + 1] - 1]`.
+// Nodes in a dependency cycle are placed in their original order.
+static bool order_by_dependencies(size_t num_nodes, const size_t* edge_starts, const size_t* edges, size_t* order) {
+	bool* is_placed = calloc(num_nodes > 0 ? num_nodes : 1, sizeof(bool));
+	bool has_cycle = false;
+	for (size_t num_placed = 0; num_placed < num_nodes; num_placed++) {
+		size_t next = num_nodes;
+		size_t first_unplaced = num_nodes;
+		for (size_t i = 0; i < num_nodes && next == num_nodes; i++) {
+			if (is_placed[i]) {
+				continue;
+			}
+			if (first_unplaced == num_nodes) {
+				first_unplaced = i;
+			}
+			bool is_ready = true;
+			for (size_t e = edge_starts[i]; e < edge_starts[i + 1] && is_ready; e++) {
+				is_ready = is_placed[edges[e]];
+			}
+			if (is_ready) {
+				next = i;
+			}
+		}
+		if (next == num_nodes) {
+			has_cycle = true;
+			next = first_unplaced;
+		}
+		is_placed[next] = true;
+		order[num_placed] = next;
+	}
+	free(is_placed);
+	return !has_cycle;
+}
+
+// Reorders test suites, and tests within suites, so that the prerequisites of
+// TEST_DEPENDS() tests run first.
+static void order_by_prerequisites(rktest_environment_t* env) {
+	/* Order tests within each suite */
+	vec_foreach(rktest_suite_t*, suite, env->test_suites) {
+		const size_t num_tests = vec_len(suite->tests);
+		vec_t(size_t) edge_starts = vec_new();
+		vec_t(size_t) edges = vec_new();
+		for (size_t i = 0; i < num_tests; i++) {
+			vec_push(edge_starts, vec_len(edges));
+			for (const char* const* prerequisite = suite->tests[i].prerequisites; prerequisite && *prerequisite; prerequisite++) {
+				for (size_t j = 0; j < num_tests; j++) {
+					if (is_instance_of(&suite->tests[j], *prerequisite)) {
+						vec_push(edges, j);
+					}
+				}
+			}
+		}
+		vec_push(edge_starts, vec_len(edges));
+
+		size_t* order = malloc((num_tests > 0 ? num_tests : 1) * sizeof(size_t));
+		if (!order_by_dependencies(num_tests, edge_starts, edges, order)) {
+			fprintf(stderr, "Warning: Circular test dependencies in %s\n", suite->name);
+		}
+		vec_t(rktest_test_t) ordered_tests = vec_new();
+		for (size_t i = 0; i < num_tests; i++) {
+			vec_push(ordered_tests, suite->tests[order[i]]);
+		}
+		free(order);
+		vec_free(edge_starts);
+		vec_free(edges);
+		vec_free(suite->tests);
+		suite->tests = ordered_tests;
+	}
+
+	/* Order suites by the prerequisites of their tests in other suites */
+	const size_t num_suites = vec_len(env->test_suites);
+	vec_t(size_t) edge_starts = vec_new();
+	vec_t(size_t) edges = vec_new();
+	vec_foreach(const rktest_suite_t*, suite, env->test_suites) {
+		vec_push(edge_starts, vec_len(edges));
+		vec_foreach(const rktest_test_t*, test, suite->tests) {
+			for (const char* const* prerequisite = test->prerequisites; prerequisite && *prerequisite; prerequisite++) {
+				for (size_t other_index = 0; other_index < num_suites; other_index++) {
+					const rktest_suite_t* other_suite = &env->test_suites[other_index];
+					if (other_suite == suite) {
+						continue;
+					}
+					vec_foreach(const rktest_test_t*, other, other_suite->tests) {
+						if (is_instance_of(other, *prerequisite)) {
+							vec_push(edges, other_index);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+	vec_push(edge_starts, vec_len(edges));
+
+	size_t* order = malloc((num_suites > 0 ? num_suites : 1) * sizeof(size_t));
+	if (!order_by_dependencies(num_suites, edge_starts, edges, order)) {
+		fprintf(stderr, "Warning: Circular test dependencies between test suites\n");
+	}
+	vec_t(rktest_suite_t) ordered_suites = vec_new();
+	for (size_t i = 0; i < num_suites; i++) {
+		vec_push(ordered_suites, env->test_suites[order[i]]);
+	}
+	free(order);
+	vec_free(edge_starts);
+	vec_free(edges);
+	vec_free(env->test_suites);
+	env->test_suites = ordered_suites;
+}
+
+// Returns the first prerequisite of `test` that failed or was skipped, if any.
+// A prerequisite split into instances only passes if every instance passed.
+// Prerequisites that are disabled or filtered out never run, so they are unmet.
+static const char* find_unmet_prerequisite(vec_t(rktest_suite_t) suites, const rktest_test_t* test) {
+	for (const char* const* prerequisite = test->prerequisites; prerequisite && *prerequisite; prerequisite++) {
+		bool is_found = false;
+		vec_foreach(const rktest_suite_t*, suite, suites) {
+			vec_foreach(const rktest_test_t*, other, suite->tests) {
+				if (!is_instance_of(other, *prerequisite)) {
+					continue;
+				}
+				is_found = true;
+				if (other->is_disabled || other->outcome == RKTEST_OUTCOME_FAILED || other->outcome == RKTEST_OUTCOME_SKIPPED) {
+					return *prerequisite;
+				}
+			}
+		}
+		if (!is_found) {
+			return *prerequisite;
+		}
+	}
+	return NULL;
+}
+
+static void add_test_to_suite(rktest_environment_t* env, rktest_suite_t* suite, rktest_test_t test, const rktest_config_t* config) {
+	if (!test_matches_filter(&test, config->test_filter)) {
+		return;
+	}
+	if (string_starts_with(test.test_name, "DISABLED_")) {
+		test.is_disabled = true;
+		suite->num_disabled_tests++;
+		env->total_num_disabled_tests++;
+	} else {
+		test.is_disabled = false;
+		env->total_num_filtered_tests++;
+	}
+	vec_push(suite->tests, test);
+}
+
+// Loop through the entirety of the `rkdata` memory section, including padding.
+// If the iterator `it` points to null, it's padding and we skip it.
+// If it's non-null, we have a test and push it into `tests`.
+static rktest_environment_t setup_test_env(const rktest_config_t* config) {
+	rktest_environment_t env = { 0 };
+	bool has_isa_tests = false;
+
+	run_registration_hooks();
+	for (size_t i = 0; i < get_num_test_definitions(); i++) {
+		const rktest_test_t* definition = get_test_definition(i);
+		if (definition == NULL || definition->registration_hook) {
+			continue;
+		}
+
+		rktest_test_t test = *definition;
+
+		if (test.isa_hook) {
+			env.isa_hook = test.isa_hook;
+			continue;
+		}
+
+		/* Probes are run on demand by RKTEST_REQUIRE() */
+		if (test.probe) {
+			rktest_probe_t probe = { 0 };
+			probe.name = test.test_name;
+			probe.probe = test.probe;
+			vec_push(g_probes, probe);
+			continue;
+		}
+
+		/* Benchmarks are kept apart from tests */
+		if (test.bench) {
+			if (*config->benchmark_filter && test_matches_pattern(&test, config->benchmark_filter)) {
+				vec_push(env.benchmarks, test);
+			}
+			continue;
+		}
+		if (test.bench_setup || test.bench_teardown) {
+			vec_push(env.benchmark_fixtures, test);
+			continue;
+		}
+
+		/* Find or add test suite */
+		rktest_suite_t* suite = find_suite_with_name(env.test_suites, test.suite_name);
+		if (!suite) {
+			rktest_suite_t new_suite = { 0 };
+			new_suite.name = test.suite_name;
+			vec_push(env.test_suites, new_suite);
+			suite = &vec_back(env.test_suites);
+		}
 
 		/* Check if setup/teardown */
 		if (test.setup) {
 			suite->setup = test.setup;
 		} else if (test.teardown) {
 			suite->teardown = test.teardown;
+		} else if (test.shared_setup) {
+			suite->shared_setup = test.shared_setup;
+		} else if (test.suite_setup) {
+			suite->suite_setup = test.suite_setup;
+			suite->is_setup_independent = test.is_independent_fixture;
+		} else if (test.suite_teardown) {
+			suite->suite_teardown = test.suite_teardown;
+			suite->is_teardown_independent = test.is_independent_fixture;
+		}
+		/* Else: Add one instance per supported ISA level of TEST_ISA() tests */
+		else if (test.is_isa_test) {
+			has_isa_tests = true;
+			for (int isa = RKTEST_ISA_SCALAR; isa <= (int)config->isa_max; isa++) {
+				if (!isa_is_supported((rktest_isa_t)isa)) {
+					continue;
+				}
+				char instance_name[RKTEST_MAX_TEST_NAME_LENGTH];
+				snprintf(instance_name, sizeof(instance_name), "%s[%s]", test.test_name, g_isa_names[isa]);
+				vec_push(env.instance_names, string_duplicate(instance_name));
+				rktest_test_t instance = test;
+				instance.test_name = vec_back(env.instance_names);
+				instance.isa = (rktest_isa_t)isa;
+				add_test_to_suite(&env, suite, instance, config);
+			}
+		}
+		/* Else: Add one instance per shard of TEST_DATA() and TEST_INDEXED() tests, named without a slash, which
+		 * would start a subtest filter */
+		else if ((test.run_record || test.run_index) && config->shards > 1) {
+			for (size_t shard = 0; shard < config->shards; shard++) {
+				char instance_name[RKTEST_MAX_TEST_NAME_LENGTH];
+				snprintf(instance_name, sizeof(instance_name), "%s[%zuof%zu]", test.test_name, shard + 1, config->shards);
+				vec_push(env.instance_names, string_duplicate(instance_name));
+				rktest_test_t instance = test;
+				instance.test_name = vec_back(env.instance_names);
+				instance.shard = shard;
+				instance.num_shards = config->shards;
+				add_test_to_suite(&env, suite, instance, config);
+			}
 		}
 		/* Else: Add test to suite */
-		else if (test_matches_filter(&test, config->test_filter)) {
-			if (string_starts_with(test.test_name, "DISABLED_")) {
-				test.is_disabled = true;
-				suite->num_disabled_tests++;
-				env.total_num_disabled_tests++;
+		else {
+			add_test_to_suite(&env, suite, test, config);
+		}
+	}
+
+	for (int isa = RKTEST_ISA_SCALAR; isa < RKTEST_ISA_COUNT; isa++) {
+		if (isa_is_supported((rktest_isa_t)isa)) {
+			env.native_isa = (rktest_isa_t)isa;
+		}
+	}
+	g_current_isa = env.native_isa;
+	if (has_isa_tests && !env.isa_hook) {
+		fprintf(stderr, "Warning: TEST_ISA() tests are run without a RKTEST_ISA_HOOK() to override the dispatch\n");
+	}
+
+	/* Run prerequisites of TEST_DEPENDS() tests first */
+	bool has_prerequisites = false;
+	vec_foreach(const rktest_suite_t*, suite, env.test_suites) {
+		vec_foreach(const rktest_test_t*, test, suite->tests) {
+			for (const char* const* prerequisite = test->prerequisites; prerequisite && *prerequisite; prerequisite++) {
+				has_prerequisites = true;
+				if (!is_registered_test(*prerequisite)) {
+					fprintf(stderr, "Warning: Unknown prerequisite %s of %s.%s\n", *prerequisite, test->suite_name, test->test_name);
+				}
+			}
+		}
+	}
+	if (has_prerequisites) {
+		order_by_prerequisites(&env);
+	}
+
+	/* Count number of suites actually containing tests*/
+	vec_foreach(const rktest_suite_t*, suite, env.test_suites) {
+		if (suite->num_disabled_tests < vec_len(suite->tests)) {
+			env.total_num_filtered_suites++;
+		}
+	}
+
+	/* Set benchmark fixture pointers in BENCHMARK_F() benchmarks */
+	vec_foreach(rktest_test_t*, benchmark, env.benchmarks) {
+		if (benchmark->num_bench_args == 0) {
+			continue;
+		}
+		vec_foreach(const rktest_test_t*, fixture, env.benchmark_fixtures) {
+			if (strcmp(fixture->suite_name, benchmark->suite_name) != 0) {
+				continue;
+			}
+			if (fixture->bench_setup) {
+				benchmark->bench_setup = fixture->bench_setup;
 			} else {
-				test.is_disabled = false;
-				env.total_num_filtered_tests++;
+				benchmark->bench_teardown = fixture->bench_teardown;
+			}
+		}
+	}
+
+	/* Set setup/teardown pointers in tests */
+	vec_foreach(const rktest_suite_t*, suite, env.test_suites) {
+		vec_foreach(rktest_test_t*, test, suite->tests) {
+			test->setup = suite->setup;
+			test->teardown = suite->teardown;
+		}
+	}
+
+	// return env;
+	return env;
+}
+
+static rktest_outcome_t run_test(const rktest_test_t* test, const rktest_config_t* config) {
+	rktest_log_info("[ RUN      ] ", "%s.%s \n", test->suite_name, test->test_name);
+
+	/* Snapshot resources before setup, so setup/teardown pairs cancel out */
+	const bool leak_check_enabled = config->leak_check_mode != RKTEST_LEAK_CHECK_OFF;
+	rktest_resource_snapshot_t resources_before = { 0 };
+	if (leak_check_enabled) {
+		resources_before = take_resource_snapshot();
+	}
+
+	const bool oom_sweep_enabled = oom_sweep_enabled_for(test, config);
+	if (oom_sweep_enabled) {
+		begin_oom_sweep();
+	}
+
+	/* Run setup if exists */
+	if (test->setup) {
+		test->setup();
+	}
+
+	/* Run test, unless skipped by setup */
+	uint64_t perf_counts[RKTEST_PERF_MAX_COUNTERS] = { 0 };
+	rktest_timer_t test_timer = rktest_timer_start();
+	begin_perf_counting();
+	if (!g_current_test_skipped) {
+		begin_subtests(test, config);
+		g_oom_sweep_is_injecting = oom_sweep_enabled;
+		if (test->run_record) {
+			run_data_test(test);
+		} else if (test->run_index) {
+			run_indexed_test(test);
+		} else if (test->run_with_context) {
+			test->run_with_context(test->context);
+		} else {
+			test->run();
+		}
+		g_oom_sweep_is_injecting = false;
+		end_subtests();
+	}
+	end_perf_counting(perf_counts);
+	rktest_millis_t test_time_ms = rktest_timer_stop(&test_timer);
+
+	/* Run teardown if exists*/
+	if (test->teardown) {
+		test->teardown();
+	}
+
+	/* Check outcome of failing each allocation */
+	if (oom_sweep_enabled && end_oom_sweep() > 0) {
+		rktest_fail_current_test();
+	}
+
+	/* Compare the instruction count with the baseline */
+	if (config->perf_counters_mode != RKTEST_PERF_COUNTERS_OFF && !g_current_test_skipped) {
+		char full_test_name[RKTEST_MAX_TEST_NAME_LENGTH];
+		format_full_test_name(full_test_name, sizeof(full_test_name), test);
+		if (!check_perf_counts(full_test_name, perf_counts, config)) {
+			rktest_fail_current_test();
+		}
+	}
+
+	/* Check for leaked resources */
+	if (leak_check_enabled) {
+		const bool leaks_are_errors = config->leak_check_mode == RKTEST_LEAK_CHECK_FAIL;
+		rktest_resource_snapshot_t resources_after = take_resource_snapshot();
+		const size_t num_leaks = print_leaked_resources(&resources_before, &resources_after, leaks_are_errors);
+		if (num_leaks > 0 && leaks_are_errors) {
+			rktest_fail_current_test();
+		}
+		free_resource_snapshot(&resources_before);
+		free_resource_snapshot(&resources_after);
+	}
+
+	/* Handle test failure, which takes precedence over skipping */
+	rktest_outcome_t outcome = RKTEST_OUTCOME_PASSED;
+	if (g_current_test_failed) {
+		outcome = RKTEST_OUTCOME_FAILED;
+	} else if (g_current_test_skipped) {
+		outcome = RKTEST_OUTCOME_SKIPPED;
+	}
+	g_current_test_failed = false;
+	g_current_test_skipped = false;
+
+	if (outcome == RKTEST_OUTCOME_PASSED) {
+		rktest_printf_green("[       OK ] ");
+	} else if (outcome == RKTEST_OUTCOME_SKIPPED) {
+		rktest_printf_yellow("[  SKIPPED ] ");
+	} else {
+		rktest_printf_red("[  FAILED  ] ");
+	}
+	printf("%s.%s ", test->suite_name, test->test_name);
+	if (config->print_timestamps_enabled) {
+		printf("(%d ms)", test_time_ms);
+	}
+	printf("\n");
+
+	return outcome;
+}
+
+#ifdef RKTEST_JOBS_SUPPORTED
+// State of the worker processes of --rktest_jobs. The pointed to values are in
+// memory shared by the workers and the parent process.
+typedef struct {
+	size_t* next_suite; // index of the next suite to be started by a worker
+	size_t* worker_suites; // index of the suite each worker is running, or SIZE_MAX
+	size_t* worker_next_suites; // index of the suite each worker has taken next, or SIZE_MAX
+	rktest_outcome_t* outcomes; // of every test, in suite order
+	bool* failed_teardowns; // of every suite
+	size_t* first_test_indices; // index in `outcomes` of the first test of each suite
+	size_t worker; // index of this worker process
+} rktest_jobs_t;
+
+static rktest_jobs_t* g_jobs = NULL; // set in worker processes
+#endif
+
+// Waits until the prerequisites of `test` that are run by other workers are done,
+// polling less and less often. A prerequisite that takes longer than
+// RKTEST_PREREQUISITE_TIMEOUT_S counts as failed.
+static void wait_for_prerequisites(rktest_environment_t* env, const rktest_suite_t* suite, const rktest_test_t* test) {
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (!g_jobs) {
+		return;
+	}
+	for (const char* const* prerequisite = test->prerequisites; prerequisite && *prerequisite; prerequisite++) {
+		const rktest_nanos_t deadline = rktest_clock_nanos() + (rktest_nanos_t)RKTEST_PREREQUISITE_TIMEOUT_S * 1000000000;
+		/* Prerequisites are ordered first, so only earlier suites can be running elsewhere */
+		vec_foreach(rktest_suite_t*, other_suite, env->test_suites) {
+			if (other_suite == suite) {
+				break;
+			}
+			const size_t suite_index = (size_t)(other_suite - env->test_suites);
+			for (size_t i = 0; i < vec_len(other_suite->tests); i++) {
+				rktest_test_t* other = &other_suite->tests[i];
+				if (other->is_disabled || !is_instance_of(other, *prerequisite)) {
+					continue;
+				}
+				const rktest_outcome_t* outcome = &g_jobs->outcomes[g_jobs->first_test_indices[suite_index] + i];
+				long poll_interval_ns = 1000000;
+				while (__atomic_load_n(outcome, __ATOMIC_ACQUIRE) == RKTEST_OUTCOME_NOT_RUN && rktest_clock_nanos() < deadline) {
+					const struct timespec poll_interval = { 0, poll_interval_ns };
+					nanosleep(&poll_interval, NULL);
+					poll_interval_ns = poll_interval_ns < 64000000 ? 2 * poll_interval_ns : poll_interval_ns;
+				}
+				other->outcome = __atomic_load_n(outcome, __ATOMIC_ACQUIRE);
+				if (other->outcome == RKTEST_OUTCOME_NOT_RUN) {
+					printf("error: Timed out after %d s waiting for prerequisite %s.%s\n", RKTEST_PREREQUISITE_TIMEOUT_S, other->suite_name, other->test_name);
+					other->outcome = RKTEST_OUTCOME_FAILED;
+				}
 			}
+		}
+	}
+#else
+	(void)env;
+	(void)suite;
+	(void)test;
+#endif
+}
+
+// Makes the outcome of `test` visible to the parent and the other workers
+static void publish_test_outcome(const rktest_environment_t* env, const rktest_suite_t* suite, const rktest_test_t* test) {
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (g_jobs) {
+		const size_t suite_index = (size_t)(suite - env->test_suites);
+		__atomic_store_n(&g_jobs->outcomes[g_jobs->first_test_indices[suite_index] + (size_t)(test - suite->tests)], test->outcome, __ATOMIC_RELEASE);
+	}
+#else
+	(void)env;
+	(void)suite;
+	(void)test;
+#endif
+}
+
+// Takes the index of the next suite to run, which is SIZE_MAX or more when done
+static size_t take_next_suite(size_t* next_suite) {
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (g_jobs) {
+		const size_t suite_index = __atomic_fetch_add(g_jobs->next_suite, 1, __ATOMIC_ACQ_REL);
+		__atomic_store_n(&g_jobs->worker_next_suites[g_jobs->worker], suite_index, __ATOMIC_RELEASE);
+		return suite_index;
+	}
+#endif
+	return (*next_suite)++;
+}
 
-			/* Add test to suite */
-			vec_push(suite->tests, test);
-		}
+// Marks the start of a suite, sending its output to its own file in workers
+static void begin_suite(size_t suite_index, FILE** suite_outputs) {
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (g_jobs) {
+		__atomic_store_n(&g_jobs->worker_suites[g_jobs->worker], suite_index, __ATOMIC_RELEASE);
+		fflush(stdout);
+		fflush(stderr);
+		dup2(fileno(suite_outputs[suite_index]), STDOUT_FILENO);
+		dup2(fileno(suite_outputs[suite_index]), STDERR_FILENO);
 	}
+#else
+	(void)suite_index;
+	(void)suite_outputs;
+#endif
+}
 
-	/* Count number of suites actually containing tests*/
-	vec_foreach(const rktest_suite_t*, suite, env.test_suites) {
-		if (suite->num_disabled_tests < vec_len(suite->tests)) {
-			env.total_num_filtered_suites++;
-		}
+/* ----------------------------- Suite fixtures ---------------------------- */
+// A SUITE_SETUP() or SUITE_TEARDOWN() running on a background thread
+typedef struct {
+	void (*fixture)(void);
+	size_t suite_index;
+	rktest_fixture_status_t status;
+	rktest_thread_task_t task;
+	rktest_thread_t thread;
+	bool is_threaded; // false if it ran on the calling thread
+} rktest_background_fixture_t;
+
+// Suite fixtures running in the background with --rktest_pipeline_fixtures
+typedef struct {
+	vec_t(rktest_background_fixture_t*) setups;
+	vec_t(rktest_background_fixture_t*) teardowns;
+} rktest_fixture_pipeline_t;
+
+static void run_background_fixture(void* arg) {
+	rktest_background_fixture_t* background = arg;
+	run_suite_fixture(background->fixture, &background->status);
+}
+
+static rktest_background_fixture_t* start_background_fixture(void (*fixture)(void), size_t suite_index) {
+	rktest_background_fixture_t* background = calloc(1, sizeof(rktest_background_fixture_t));
+	background->fixture = fixture;
+	background->suite_index = suite_index;
+	background->task.thread_main = run_background_fixture;
+	background->task.arg = background;
+	background->is_threaded = start_thread(&background->thread, &background->task);
+	if (!background->is_threaded) {
+		run_background_fixture(background);
 	}
+	return background;
+}
 
-	/* Set setup/teardown pointers in tests */
-	vec_foreach(const rktest_suite_t*, suite, env.test_suites) {
-		vec_foreach(rktest_test_t*, test, suite->tests) {
-			test->setup = suite->setup;
-			test->teardown = suite->teardown;
+static rktest_fixture_status_t finish_background_fixture(rktest_background_fixture_t* background) {
+	if (background->is_threaded) {
+		join_thread(background->thread);
+	}
+	const rktest_fixture_status_t status = background->status;
+	free(background);
+	return status;
+}
+
+static bool suite_has_tests_to_run(const rktest_suite_t* suite) {
+	return suite->num_disabled_tests < vec_len(suite->tests);
+}
+
+// Starts the INDEPENDENT_SUITE_SETUP() of a suite that is about to run
+static void start_suite_setup_in_background(rktest_environment_t* env, rktest_fixture_pipeline_t* pipeline, size_t suite_index) {
+	if (suite_index >= vec_len(env->test_suites)) {
+		return;
+	}
+	const rktest_suite_t* suite = &env->test_suites[suite_index];
+	if (suite->suite_setup && suite->is_setup_independent && suite_has_tests_to_run(suite)) {
+		vec_push(pipeline->setups, start_background_fixture(suite->suite_setup, suite_index));
+	}
+}
+
+// Runs the SUITE_SETUP() of a suite, or waits for it if it runs in the background
+static rktest_fixture_status_t run_suite_setup(rktest_environment_t* env, rktest_suite_t* suite, rktest_fixture_pipeline_t* pipeline) {
+	const size_t suite_index = (size_t)(suite - env->test_suites);
+	for (size_t i = 0; i < vec_len(pipeline->setups); i++) {
+		if (pipeline->setups[i]->suite_index == suite_index) {
+			rktest_background_fixture_t* background = pipeline->setups[i];
+			pipeline->setups[i] = vec_back(pipeline->setups);
+			vec_header(pipeline->setups)->length--;
+			return finish_background_fixture(background);
 		}
 	}
+	rktest_fixture_status_t status = { 0 };
+	if (suite->suite_setup) {
+		run_suite_fixture(suite->suite_setup, &status);
+	}
+	return status;
+}
 
-	// return env;
-	return env;
+static void report_failed_suite_teardown(const rktest_environment_t* env, const rktest_suite_t* suite, rktest_report_t* report) {
+	rktest_test_t teardown = { 0 };
+	teardown.suite_name = suite->name;
+	teardown.test_name = "SUITE_TEARDOWN";
+	teardown.outcome = RKTEST_OUTCOME_FAILED;
+	vec_push(report->failed_tests, teardown);
+	rktest_log_error("[  FAILED  ] ", "%s.SUITE_TEARDOWN\n", suite->name);
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (g_jobs) {
+		__atomic_store_n(&g_jobs->failed_teardowns[suite - env->test_suites], true, __ATOMIC_RELEASE);
+	}
+#else
+	(void)env;
+#endif
 }
 
-static bool run_test(const rktest_test_t* test, const rktest_config_t* config) {
-	rktest_log_info("[ RUN      ] ", "%s.%s \n", test->suite_name, test->test_name);
+// Runs the SUITE_TEARDOWN() of a suite, in the background if it is independent
+static void run_suite_teardown(rktest_environment_t* env, rktest_suite_t* suite, const rktest_config_t* config, rktest_report_t* report, rktest_fixture_pipeline_t* pipeline) {
+	if (!suite->suite_teardown) {
+		return;
+	}
+	if (config->pipeline_fixtures_enabled && suite->is_teardown_independent) {
+		vec_push(pipeline->teardowns, start_background_fixture(suite->suite_teardown, (size_t)(suite - env->test_suites)));
+		return;
+	}
+	rktest_fixture_status_t status = { 0 };
+	run_suite_fixture(suite->suite_teardown, &status);
+	if (status.failed) {
+		report_failed_suite_teardown(env, suite, report);
+	}
+}
 
-	/* Run setup if exists */
-	if (test->setup) {
-		test->setup();
+static void finish_suite_teardowns(rktest_environment_t* env, rktest_report_t* report, rktest_fixture_pipeline_t* pipeline) {
+	vec_foreach(rktest_background_fixture_t**, teardown, pipeline->teardowns) {
+		const size_t suite_index = (*teardown)->suite_index;
+		if (finish_background_fixture(*teardown).failed) {
+			report_failed_suite_teardown(env, &env->test_suites[suite_index], report);
+		}
 	}
+	vec_free(pipeline->teardowns);
+	vec_free(pipeline->setups);
+}
 
-	/* Run test */
-	rktest_timer_t test_timer = rktest_timer_start();
-	test->run();
-	rktest_millis_t test_time_ms = rktest_timer_stop(&test_timer);
+/* --------------------------------- Suites -------------------------------- */
+static void run_suite(rktest_environment_t* env, rktest_suite_t* suite, const rktest_config_t* config, rktest_report_t* report, rktest_progress_t* progress, rktest_fixture_pipeline_t* pipeline) {
+	/* Skip suite if all cases filtered out */
+	if (!suite_has_tests_to_run(suite)) {
+		return;
+	}
 
-	/* Run teardown if exists*/
-	if (test->teardown) {
-		test->teardown();
+	const size_t num_filtered_tests = vec_len(suite->tests) - suite->num_disabled_tests;
+	if (!config->progress_enabled) {
+		rktest_log_info("[----------] ", "%zu tests from %s\n", num_filtered_tests, suite->name);
 	}
+	rktest_timer_t suite_timer = rktest_timer_start();
+	/* A failing or skipping SHARED_SETUP() counts like one of SUITE_SETUP() */
+	rktest_fixture_status_t setup_status = run_suite_setup(env, suite, pipeline);
+	setup_status.failed |= suite->shared_setup_status.failed;
+	setup_status.skipped |= suite->shared_setup_status.skipped;
+	vec_foreach(rktest_test_t*, test, suite->tests) {
+		/* Check if test is disabled, skip it*/
+		if (test->is_disabled) {
+			if (!config->progress_enabled) {
+				rktest_log_warning("[ DISABLED ] ", "%s.%s\n", test->suite_name, test->test_name);
+			}
+			continue;
+		}
 
-	/* Handle test failure */
-	const bool test_passed = !g_current_test_failed;
-	g_current_test_failed = false;
+		/* Fail or skip test without running it if the suite or shared setup did */
+		if (setup_status.failed || setup_status.skipped) {
+			test->outcome = setup_status.failed ? RKTEST_OUTCOME_FAILED : RKTEST_OUTCOME_SKIPPED;
+			publish_test_outcome(env, suite, test);
+			if (setup_status.failed) {
+				vec_push(report->failed_tests, *test);
+			} else {
+				vec_push(report->skipped_tests, *test);
+			}
+			if (config->progress_enabled && setup_status.failed) {
+				/* Count the test as failed rather than skipped, and list it like failing tests */
+				progress_begin_test(progress, test);
+				progress_end_test(progress, test, false);
+				clear_progress();
+				rktest_log_error("[  FAILED  ] ", "%s.%s\n", test->suite_name, test->test_name);
+			} else if (config->progress_enabled) {
+				progress_skip_test(progress, test);
+			} else if (setup_status.failed) {
+				rktest_log_error("[  FAILED  ] ", "%s.%s\n", test->suite_name, test->test_name);
+			} else {
+				rktest_log_warning("[  SKIPPED ] ", "%s.%s\n", test->suite_name, test->test_name);
+			}
+			continue;
+		}
 
-	if (test_passed) {
-		rktest_printf_green("[       OK ] ");
-	} else {
-		rktest_printf_red("[  FAILED  ] ");
+		/* Skip test if a prerequisite failed */
+		wait_for_prerequisites(env, suite, test);
+		const char* unmet_prerequisite = find_unmet_prerequisite(env->test_suites, test);
+		if (unmet_prerequisite) {
+			test->outcome = RKTEST_OUTCOME_SKIPPED;
+			publish_test_outcome(env, suite, test);
+			vec_push(report->skipped_tests, *test);
+			if (config->progress_enabled) {
+				progress_skip_test(progress, test);
+			} else {
+				printf("Skipped because prerequisite %s did not pass\n", unmet_prerequisite);
+				rktest_log_warning("[  SKIPPED ] ", "%s.%s\n", test->suite_name, test->test_name);
+			}
+			continue;
+		}
+
+		/* Run non-disabled test */
+		if (config->progress_enabled) {
+			progress_begin_test(progress, test);
+		}
+		/* Override the dispatch of TEST_ISA() instances */
+		const bool overrides_isa = test->is_isa_test && env->isa_hook;
+		g_current_isa = test->is_isa_test ? test->isa : env->native_isa;
+		if (overrides_isa) {
+			env->isa_hook(test->isa);
+		}
+		test->outcome = run_test(test, config);
+		g_current_isa = env->native_isa;
+		if (overrides_isa) {
+			env->isa_hook(env->native_isa);
+		}
+		publish_test_outcome(env, suite, test);
+		if (config->progress_enabled) {
+			progress_end_test(progress, test, test->outcome != RKTEST_OUTCOME_FAILED);
+		}
+		if (test->outcome == RKTEST_OUTCOME_PASSED) {
+			report->num_passed_tests++;
+		} else if (test->outcome == RKTEST_OUTCOME_SKIPPED) {
+			vec_push(report->skipped_tests, *test);
+		} else {
+			vec_push(report->failed_tests, *test);
+		}
 	}
-	printf("%s.%s ", test->suite_name, test->test_name);
+	run_suite_teardown(env, suite, config, report, pipeline);
+	rktest_millis_t suite_time_ms = rktest_timer_stop(&suite_timer);
+	if (config->progress_enabled) {
+		return;
+	}
+	rktest_log_info("[----------] ", "%zu tests from %s ", num_filtered_tests, suite->name);
 	if (config->print_timestamps_enabled) {
-		printf("(%d ms)", test_time_ms);
+		printf("(%d ms total)", suite_time_ms);
 	}
-	printf("\n");
+	printf("\n\n");
+}
 
-	return test_passed;
+// Runs suites until none are left. With --rktest_pipeline_fixtures, the next
+// suite is taken before running the current one, so that its setup can start.
+static void run_suites(rktest_environment_t* env, const rktest_config_t* config, rktest_report_t* report, rktest_progress_t* progress, FILE** suite_outputs) {
+	rktest_fixture_pipeline_t pipeline = { 0 };
+	size_t next_suite = 0;
+	size_t suite_index = take_next_suite(&next_suite);
+	while (suite_index < vec_len(env->test_suites)) {
+		begin_suite(suite_index, suite_outputs);
+		size_t following_suite_index = SIZE_MAX;
+		if (config->pipeline_fixtures_enabled) {
+			following_suite_index = take_next_suite(&next_suite);
+			start_suite_setup_in_background(env, &pipeline, following_suite_index);
+		}
+		run_suite(env, &env->test_suites[suite_index], config, report, progress, &pipeline);
+		suite_index = config->pipeline_fixtures_enabled ? following_suite_index : take_next_suite(&next_suite);
+	}
+	finish_suite_teardowns(env, report, &pipeline);
 }
 
-static rktest_report_t run_all_tests(rktest_environment_t* env, const rktest_config_t* config) {
+#ifdef RKTEST_JOBS_SUPPORTED
+// Runs suites until none are left, writing the output of each suite to its own file
+static void run_worker(rktest_environment_t* env, const rktest_config_t* config, FILE** suite_outputs) {
 	rktest_report_t report = { 0 };
+	setvbuf(stdout, NULL, _IOLBF, BUFSIZ); // keep the output up to a crash
+	run_suites(env, config, &report, NULL, suite_outputs);
+	fflush(stdout);
+	fflush(stderr);
+	__atomic_store_n(&g_jobs->worker_suites[g_jobs->worker], SIZE_MAX, __ATOMIC_RELEASE);
+	__atomic_store_n(&g_jobs->worker_next_suites[g_jobs->worker], SIZE_MAX, __ATOMIC_RELEASE);
+	vec_free(report.failed_tests);
+	vec_free(report.skipped_tests);
+}
+
+// Runs the test suites in forked worker processes, then prints the output of
+// every suite in order. Returns false if the workers could not be set up.
+static bool run_suites_in_workers(rktest_environment_t* env, const rktest_config_t* config, rktest_report_t* report) {
+	const size_t num_suites = vec_len(env->test_suites);
+	const size_t num_workers = config->jobs;
+	size_t num_tests = 0;
+	vec_t(size_t) first_test_indices = vec_new();
+	vec_foreach(const rktest_suite_t*, suite, env->test_suites) {
+		vec_push(first_test_indices, num_tests);
+		num_tests += vec_len(suite->tests);
+	}
+
+	/* Set up the shared state and a file for the output of each suite */
+	const size_t mapping_size = (1 + 2 * num_workers) * sizeof(size_t) + num_tests * sizeof(rktest_outcome_t) + num_suites * sizeof(bool);
+	void* mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	FILE** suite_outputs = calloc(num_suites + 1, sizeof(FILE*));
+	bool is_set_up = mapping != MAP_FAILED;
+	for (size_t i = 0; is_set_up && i < num_suites; i++) {
+		suite_outputs[i] = tmpfile();
+		is_set_up = suite_outputs[i] != NULL;
+	}
+	if (!is_set_up) {
+		rktest_printf_yellow("Warning: could not set up worker processes, running the tests in-process\n");
+		for (size_t i = 0; i < num_suites && suite_outputs[i]; i++) {
+			fclose(suite_outputs[i]);
+		}
+		if (mapping != MAP_FAILED) {
+			munmap(mapping, mapping_size);
+		}
+		free(suite_outputs);
+		vec_free(first_test_indices);
+		return false;
+	}
+	rktest_jobs_t jobs = { 0 };
+	jobs.next_suite = mapping;
+	jobs.worker_suites = jobs.next_suite + 1;
+	jobs.worker_next_suites = jobs.worker_suites + num_workers;
+	jobs.outcomes = (rktest_outcome_t*)(jobs.worker_next_suites + num_workers);
+	jobs.failed_teardowns = (bool*)(jobs.outcomes + num_tests);
+	jobs.first_test_indices = first_test_indices;
+	for (size_t i = 0; i < num_workers; i++) {
+		jobs.worker_suites[i] = SIZE_MAX;
+		jobs.worker_next_suites[i] = SIZE_MAX;
+	}
+
+	/* Start workers */
+	fflush(stdout);
+	fflush(stderr);
+	vec_t(pid_t) workers = vec_new();
+	for (size_t i = 0; i < num_workers; i++) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			jobs.worker = i;
+			g_jobs = &jobs;
+			run_worker(env, config, suite_outputs);
+			_exit(0);
+		}
+		if (pid < 0) {
+			break;
+		}
+		vec_push(workers, pid);
+	}
+
+	/* The suites are taken by whichever workers did start, unless none did */
+	if (vec_len(workers) == 0) {
+		rktest_printf_yellow("Warning: could not start worker processes, running the tests in-process\n");
+		for (size_t i = 0; i < num_suites; i++) {
+			fclose(suite_outputs[i]);
+		}
+		munmap(mapping, mapping_size);
+		free(suite_outputs);
+		vec_free(first_test_indices);
+		vec_free(workers);
+		return false;
+	}
+	if (vec_len(workers) < num_workers) {
+		rktest_printf_yellow("Warning: could only start %zu of %zu worker processes\n", vec_len(workers), num_workers);
+	}
+
+	/* Fail the remaining tests of suites whose worker died, so that nothing waits for them */
+	bool* is_abandoned = calloc(num_tests + 1, sizeof(bool));
+	size_t num_running = vec_len(workers);
+	while (num_running > 0) {
+		int status = 0;
+		const pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			break;
+		}
+		for (size_t i = 0; i < vec_len(workers); i++) {
+			if (workers[i] != pid) {
+				continue;
+			}
+			num_running--;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+				break;
+			}
+			const size_t abandoned_suites[] = {
+				__atomic_load_n(&jobs.worker_suites[i], __ATOMIC_ACQUIRE),
+				__atomic_load_n(&jobs.worker_next_suites[i], __ATOMIC_ACQUIRE),
+			};
+			for (size_t k = 0; k < sizeof(abandoned_suites) / sizeof(abandoned_suites[0]); k++) {
+				const size_t suite_index = abandoned_suites[k];
+				if (suite_index >= num_suites) {
+					continue;
+				}
+				const rktest_suite_t* suite = &env->test_suites[suite_index];
+				for (size_t j = 0; j < vec_len(suite->tests); j++) {
+					const size_t test_index = first_test_indices[suite_index] + j;
+					if (!suite->tests[j].is_disabled && __atomic_load_n(&jobs.outcomes[test_index], __ATOMIC_ACQUIRE) == RKTEST_OUTCOME_NOT_RUN) {
+						is_abandoned[test_index] = true;
+						__atomic_store_n(&jobs.outcomes[test_index], RKTEST_OUTCOME_FAILED, __ATOMIC_RELEASE);
+					}
+				}
+			}
+		}
+	}
 
+	/* Print the output and collect the outcomes of each suite */
 	vec_foreach(rktest_suite_t*, suite, env->test_suites) {
-		/* Skip suite if all cases filtered out */
-		if (suite->num_disabled_tests == vec_len(suite->tests)) {
-			continue;
+		const size_t suite_index = (size_t)(suite - env->test_suites);
+		FILE* output = suite_outputs[suite_index];
+		rewind(output);
+		char buffer[4096];
+		size_t num_read;
+		while ((num_read = fread(buffer, 1, sizeof(buffer), output)) > 0) {
+			fwrite(buffer, 1, num_read, stdout);
 		}
+		fclose(output);
 
-		const size_t num_filtered_tests = vec_len(suite->tests) - suite->num_disabled_tests;
-		rktest_log_info("[----------] ", "%zu tests from %s\n", num_filtered_tests, suite->name);
-		rktest_timer_t suite_timer = rktest_timer_start();
-		vec_foreach(const rktest_test_t*, test, suite->tests) {
-			/* Check if test is disabled, skip it*/
+		bool printed_exit_error = false;
+		vec_foreach(rktest_test_t*, test, suite->tests) {
+			const size_t test_index = first_test_indices[suite_index] + (size_t)(test - suite->tests);
 			if (test->is_disabled) {
-				rktest_log_warning("[ DISABLED ] ", "%s.%s\n", test->suite_name, test->test_name);
 				continue;
 			}
-
-			/* Run non-disabled test */
-			const bool test_passed = run_test(test, config);
-			if (test_passed) {
-				report.num_passed_tests++;
+			test->outcome = jobs.outcomes[test_index];
+			if (is_abandoned[test_index]) {
+				if (!printed_exit_error) {
+					printf("\nerror: Worker process exited unexpectedly\n");
+					printed_exit_error = true;
+				}
+				rktest_log_error("[  FAILED  ] ", "%s.%s\n", test->suite_name, test->test_name);
+			}
+			if (test->outcome == RKTEST_OUTCOME_PASSED) {
+				report->num_passed_tests++;
+			} else if (test->outcome == RKTEST_OUTCOME_SKIPPED) {
+				vec_push(report->skipped_tests, *test);
 			} else {
-				vec_push(report.failed_tests, *test);
+				vec_push(report->failed_tests, *test);
 			}
 		}
-		rktest_millis_t suite_time_ms = rktest_timer_stop(&suite_timer);
-		rktest_log_info("[----------] ", "%zu tests from %s ", num_filtered_tests, suite->name);
-		if (config->print_timestamps_enabled) {
-			printf("(%d ms total)", suite_time_ms);
+		if (printed_exit_error) {
+			printf("\n");
+		}
+		if (jobs.failed_teardowns[suite_index]) {
+			rktest_test_t teardown = { 0 };
+			teardown.suite_name = suite->name;
+			teardown.test_name = "SUITE_TEARDOWN";
+			teardown.outcome = RKTEST_OUTCOME_FAILED;
+			vec_push(report->failed_tests, teardown);
 		}
-		printf("\n\n");
+	}
+
+	free(is_abandoned);
+	vec_free(workers);
+	munmap(mapping, mapping_size);
+	free(suite_outputs);
+	vec_free(first_test_indices);
+	return true;
+}
+#endif // RKTEST_JOBS_SUPPORTED
+
+static rktest_report_t run_all_tests(rktest_environment_t* env, const rktest_config_t* config) {
+	rktest_report_t report = { 0 };
+	run_shared_setups(env);
+#ifdef RKTEST_JOBS_SUPPORTED
+	if (config->jobs > 1 && run_suites_in_workers(env, config, &report)) {
+		return report;
+	}
+#endif
+
+	rktest_progress_t progress = { 0 };
+	if (config->progress_enabled) {
+		progress = start_progress(env);
+	}
+
+	run_suites(env, config, &report, &progress, NULL);
+
+	if (config->progress_enabled) {
+		finish_progress(&progress);
 	}
 
 	return report;
 }
 
+static rktest_bench_t run_benchmark_body(const rktest_test_t* benchmark, const rktest_config_t* config, const rktest_bench_params_t* params) {
+	rktest_bench_t bench = { 0 };
+	bench.histogram = histogram_new();
+	bench.min_time_ns = (rktest_nanos_t)(config->benchmark_min_time_s * 1e9);
+	bench.batch_size = 1;
+	bench.ops_per_sec = params->ops_per_sec;
+	bench.arg = params->arg;
+	bench.alignment_offset = params->alignment_offset;
+	/* Only the timed iterations are counted, see rktest_bench_loop() */
+	reset_perf_counters();
+	benchmark->bench(&bench);
+	end_perf_counting(bench.perf_counts);
+
+	vec_foreach(void**, buffer, bench.buffers) {
+		free(*buffer);
+	}
+	vec_free(bench.buffers);
+	free_bench_allocations(&bench);
+	return bench;
+}
+
+#ifdef RKTEST_BENCHMARK_ISOLATION_SUPPORTED
+static bool write_fully(int fd, const void* data, size_t size) {
+	const char* bytes = data;
+	while (size > 0) {
+		const ssize_t written = write(fd, bytes, size);
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= (size_t)written;
+	}
+	return true;
+}
+
+static bool read_fully(int fd, void* data, size_t size) {
+	char* bytes = data;
+	while (size > 0) {
+		const ssize_t num_read = read(fd, bytes, size);
+		if (num_read <= 0) {
+			return false;
+		}
+		bytes += num_read;
+		size -= (size_t)num_read;
+	}
+	return true;
+}
+
+// Runs the benchmark body in a forked child, which sends the benchmark state
+// followed by the histogram counts back through a pipe.
+static rktest_bench_t run_benchmark_body_isolated(const rktest_test_t* benchmark, const rktest_config_t* config, const rktest_bench_params_t* params) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		rktest_printf_yellow("Warning: could not create a pipe, running the benchmark in-process\n");
+		return run_benchmark_body(benchmark, config, params);
+	}
+
+	fflush(stdout);
+	const pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		if (g_perf.is_available) {
+			close_perf_counters();
+			open_perf_counters(config, false);
+		}
+		const rktest_bench_t bench = run_benchmark_body(benchmark, config, params);
+		const bool is_sent = write_fully(fds[1], &bench, sizeof(bench))
+			&& write_fully(fds[1], bench.histogram.counts, RKTEST_HISTOGRAM_NUM_BUCKETS * sizeof(uint64_t));
+		fflush(stdout);
+		_exit(is_sent ? 0 : 1);
+	}
+	close(fds[1]);
+
+	rktest_bench_t bench = { 0 };
+	uint64_t* counts = calloc(RKTEST_HISTOGRAM_NUM_BUCKETS, sizeof(uint64_t));
+	const bool is_received = pid > 0 && read_fully(fds[0], &bench, sizeof(bench))
+		&& read_fully(fds[0], counts, RKTEST_HISTOGRAM_NUM_BUCKETS * sizeof(uint64_t));
+	close(fds[0]);
+	if (pid > 0) {
+		waitpid(pid, NULL, 0);
+	}
+
+	if (!is_received) {
+		rktest_printf_yellow("Warning: benchmark process exited without reporting its results\n");
+		free(counts);
+		bench = (rktest_bench_t){ 0 };
+		bench.histogram = histogram_new();
+		bench.ops_per_sec = params->ops_per_sec;
+		bench.arg = params->arg;
+		bench.alignment_offset = params->alignment_offset;
+		return bench;
+	}
+	bench.histogram.counts = counts;
+	return bench;
+}
+#endif // RKTEST_BENCHMARK_ISOLATION_SUPPORTED
+
+// Runs the benchmark body once. The caller frees the returned histogram.
+static rktest_bench_t run_benchmark_once(const rktest_test_t* benchmark, const rktest_config_t* config, const rktest_bench_params_t* params) {
+#ifdef RKTEST_BENCHMARK_ISOLATION_SUPPORTED
+	if (config->benchmark_isolation == RKTEST_BENCHMARK_ISOLATION_PROCESS) {
+		const rktest_bench_t bench = run_benchmark_body_isolated(benchmark, config, params);
+		g_benchmark_failed = g_benchmark_failed || bench.is_failed;
+		return bench;
+	}
+#endif
+	const rktest_bench_t bench = run_benchmark_body(benchmark, config, params);
+	g_benchmark_failed = g_benchmark_failed || bench.is_failed;
+	return bench;
+}
+
+static void print_benchmark_done(const char* name, const rktest_config_t* config, rktest_millis_t benchmark_time_ms) {
+	rktest_printf_green("[     DONE ] ");
+	printf("%s ", name);
+	if (config->print_timestamps_enabled) {
+		printf("(%d ms)", benchmark_time_ms);
+	}
+	printf("\n");
+}
+
+static void teardown_benchmark_fixture(rktest_bench_fixture_t* fixture) {
+	if (fixture->is_set_up) {
+		fixture->is_set_up = false;
+		if (fixture->teardown) {
+			fixture->teardown(fixture->arg);
+		}
+	}
+}
+
+static void setup_benchmark_fixture(rktest_bench_fixture_t* fixture, const rktest_test_t* benchmark, int64_t arg) {
+	if (fixture->is_set_up && fixture->arg == arg && strcmp(fixture->suite_name, benchmark->suite_name) == 0) {
+		return;
+	}
+
+	teardown_benchmark_fixture(fixture);
+	if (benchmark->bench_setup) {
+		benchmark->bench_setup(arg);
+	}
+	fixture->suite_name = benchmark->suite_name;
+	fixture->teardown = benchmark->bench_teardown;
+	fixture->arg = arg;
+	fixture->is_set_up = true;
+}
+
+// Runs a rate benchmark at doubling rates, until either the achieved rate falls
+// behind the target rate or the p99 latency has grown far beyond the p99 at the
+// registered rate, and reports the last rate that was sustained.
+static void run_rate_sweep(const rktest_test_t* benchmark, const char* name, const rktest_config_t* config, const rktest_bench_params_t* params, rktest_benchmark_json_t* json) {
+	rktest_timer_t benchmark_timer = rktest_timer_start();
+	vec_t(rktest_bench_t) steps = vec_new();
+	double sustained_ops_per_sec = 0.0;
+	uint64_t baseline_p99 = 0;
+	rktest_bench_params_t step_params = *params;
+	double ops_per_sec = params->ops_per_sec;
+	for (int i = 0; i < RKTEST_RATE_SWEEP_MAX_STEPS; i++, ops_per_sec *= 2.0) {
+		step_params.ops_per_sec = ops_per_sec;
+		rktest_bench_t bench = run_benchmark_once(benchmark, config, &step_params);
+		vec_push(steps, bench);
+
+		const uint64_t p99 = histogram_percentile(&bench.histogram, 99.0);
+		if (i == 0) {
+			baseline_p99 = p99 > 0 ? p99 : 1;
+		}
+		const bool throughput_saturated = bench_achieved_ops_per_sec(&bench) < RKTEST_RATE_SWEEP_MIN_THROUGHPUT * ops_per_sec;
+		const bool latency_saturated = (double)p99 > RKTEST_RATE_SWEEP_MAX_P99_GROWTH * (double)baseline_p99;
+		if (bench.num_iterations == 0 || throughput_saturated || latency_saturated) {
+			break;
+		}
+		sustained_ops_per_sec = ops_per_sec;
+	}
+	rktest_millis_t benchmark_time_ms = rktest_timer_stop(&benchmark_timer);
+
+	print_benchmark_done(name, config, benchmark_time_ms);
+	vec_foreach(rktest_bench_t*, bench, steps) {
+		print_benchmark_result(bench);
+
+		char step_name[RKTEST_MAX_TEST_NAME_LENGTH];
+		snprintf(step_name, sizeof(step_name), "%s/rate:%.0f", name, bench->ops_per_sec);
+		write_benchmark_json(json, step_name, bench);
+		histogram_free(&bench->histogram);
+	}
+	if (sustained_ops_per_sec > 0.0) {
+		printf("             saturation knee: %.0f ops/s sustained, saturated at %.0f ops/s\n", sustained_ops_per_sec, vec_back(steps).ops_per_sec);
+	} else {
+		printf("             saturation knee: already saturated at %.0f ops/s\n", benchmark->ops_per_sec);
+	}
+	vec_free(steps);
+}
+
+static int compare_uint64(const void* lhs, const void* rhs) {
+	const uint64_t lhs_value = *(const uint64_t*)lhs;
+	const uint64_t rhs_value = *(const uint64_t*)rhs;
+	return (lhs_value > rhs_value) - (lhs_value < rhs_value);
+}
+
+// Adds the iterations, timed duration and perf counts of a repetition to `aggregate`
+static void merge_bench(rktest_bench_t* aggregate, const rktest_bench_t* bench) {
+	histogram_merge(&aggregate->histogram, &bench->histogram);
+	aggregate->num_iterations += bench->num_iterations;
+	aggregate->end_ns += bench->end_ns - bench->start_ns;
+	for (size_t i = 0; i < RKTEST_PERF_MAX_COUNTERS; i++) {
+		aggregate->perf_counts[i] += bench->perf_counts[i];
+	}
+}
+
+// Runs the benchmark with its rktest_bench_buffer() buffers at every stride
+// bytes offset from page alignment, each offset for the configured number of
+// repetitions, and reports how the median latency varies with the offset.
+// `first` is a run at offset 0, which tells whether the benchmark uses buffers.
+static void run_alignment_sweep(const rktest_test_t* benchmark, const char* name, const rktest_config_t* config, const rktest_bench_params_t* params, rktest_bench_t first, rktest_benchmark_json_t* json) {
+	rktest_timer_t benchmark_timer = rktest_timer_start();
+	vec_t(rktest_bench_t) offsets = vec_new();
+	rktest_bench_params_t offset_params = *params;
+	for (size_t offset = 0; offset < RKTEST_ALIGNMENT_SWEEP_NUM_OFFSETS; offset += config->benchmark_alignment_stride) {
+		offset_params.alignment_offset = offset;
+		rktest_bench_t bench = offset == 0 ? first : run_benchmark_once(benchmark, config, &offset_params);
+		for (size_t i = 1; i < config->benchmark_repetitions; i++) {
+			rktest_bench_t repetition = run_benchmark_once(benchmark, config, &offset_params);
+			merge_bench(&bench, &repetition);
+			histogram_free(&repetition.histogram);
+		}
+		vec_push(offsets, bench);
+	}
+	rktest_millis_t benchmark_time_ms = rktest_timer_stop(&benchmark_timer);
+
+	print_benchmark_done(name, config, benchmark_time_ms);
+	vec_t(uint64_t) p50s = vec_new();
+	const rktest_bench_t* best = &offsets[0];
+	const rktest_bench_t* worst = &offsets[0];
+	vec_foreach(const rktest_bench_t*, bench, offsets) {
+		const uint64_t p50 = histogram_percentile(&bench->histogram, 50.0);
+		vec_push(p50s, p50);
+		if (p50 < histogram_percentile(&best->histogram, 50.0)) {
+			best = bench;
+		}
+		if (p50 > histogram_percentile(&worst->histogram, 50.0)) {
+			worst = bench;
+		}
+	}
+	const uint64_t best_p50 = histogram_percentile(&best->histogram, 50.0);
+
+	qsort(p50s, vec_len(p50s), sizeof(*p50s), compare_uint64);
+	char best_buf[32], median_buf[32], worst_buf[32];
+	format_nanos(best_buf, sizeof(best_buf), (double)best_p50);
+	format_nanos(median_buf, sizeof(median_buf), (double)p50s[vec_len(p50s) / 2]);
+	format_nanos(worst_buf, sizeof(worst_buf), (double)histogram_percentile(&worst->histogram, 50.0));
+	printf("             %zu offsets: best p50 %s (offset %zu), median p50 %s, worst p50 %s (offset %zu)\n",
+		vec_len(offsets), best_buf, best->alignment_offset, median_buf, worst_buf, worst->alignment_offset);
+
+	printf("             slow offsets (p50 more than %.0f%% above best):", (RKTEST_ALIGNMENT_SWEEP_SLOW_THRESHOLD - 1.0) * 100.0);
+	size_t num_slow_offsets = 0;
+	vec_foreach(const rktest_bench_t*, bench, offsets) {
+		if ((double)histogram_percentile(&bench->histogram, 50.0) > RKTEST_ALIGNMENT_SWEEP_SLOW_THRESHOLD * (double)best_p50) {
+			printf(" %zu", bench->alignment_offset);
+			num_slow_offsets++;
+		}
+	}
+	printf("%s\n", num_slow_offsets == 0 ? " none" : "");
+
+	vec_foreach(rktest_bench_t*, bench, offsets) {
+		char offset_name[RKTEST_MAX_TEST_NAME_LENGTH];
+		snprintf(offset_name, sizeof(offset_name), "%s/offset:%zu", name, bench->alignment_offset);
+		write_benchmark_json(json, offset_name, bench);
+		histogram_free(&bench->histogram);
+	}
+	vec_free(p50s);
+	vec_free(offsets);
+}
+
+static void run_benchmark_with_arg(const rktest_test_t* benchmark, const char* name, const rktest_config_t* config, int64_t arg, rktest_benchmark_json_t* json) {
+	rktest_log_info("[ RUN      ] ", "%s\n", name);
+
+	rktest_bench_params_t params = { 0 };
+	params.arg = arg;
+	params.ops_per_sec = benchmark->ops_per_sec;
+	if (benchmark->ops_per_sec > 0.0 && config->benchmark_rate_sweep_enabled) {
+		run_rate_sweep(benchmark, name, config, &params, json);
+		return;
+	}
+
+	/* The first run tells whether the benchmark uses rktest_bench_buffer() */
+	rktest_timer_t benchmark_timer = rktest_timer_start();
+	const rktest_bench_t first = run_benchmark_once(benchmark, config, &params);
+	if (config->benchmark_alignment_stride > 0 && first.num_buffers > 0) {
+		run_alignment_sweep(benchmark, name, config, &params, first, json);
+		return;
+	}
+
+	vec_t(rktest_bench_t) repetitions = vec_new();
+	vec_push(repetitions, first);
+	for (size_t i = 1; i < config->benchmark_repetitions; i++) {
+		vec_push(repetitions, run_benchmark_once(benchmark, config, &params));
+	}
+	rktest_millis_t benchmark_time_ms = rktest_timer_stop(&benchmark_timer);
+
+	print_benchmark_done(name, config, benchmark_time_ms);
+
+	/* Repetitions are aggregated into a single result, timed end to end */
+	rktest_bench_t aggregate = { 0 };
+	aggregate.histogram = histogram_new();
+	aggregate.ops_per_sec = benchmark->ops_per_sec;
+	vec_foreach(const rktest_bench_t*, bench, repetitions) {
+		merge_bench(&aggregate, bench);
+	}
+
+	for (size_t i = 0; i < vec_len(repetitions); i++) {
+		rktest_bench_t* bench = &repetitions[i];
+		if (bench->is_failed) {
+			rktest_log_error("[  FAILED  ] ", "%s\n", name);
+		} else if (bench->num_iterations == 0) {
+			rktest_printf_yellow("Warning: benchmark did not run any rktest_bench_loop() iterations\n");
+		} else {
+			print_benchmark_result(bench);
+		}
+
+		if (vec_len(repetitions) == 1) {
+			write_benchmark_json(json, name, bench);
+		} else {
+			char repetition_name[RKTEST_MAX_TEST_NAME_LENGTH];
+			snprintf(repetition_name, sizeof(repetition_name), "%s/repeat:%zu", name, i);
+			write_benchmark_json(json, repetition_name, bench);
+		}
+		histogram_free(&bench->histogram);
+	}
+	if (vec_len(repetitions) > 1 && aggregate.num_iterations > 0) {
+		printf("             aggregate of %zu repetitions:\n", vec_len(repetitions));
+		print_benchmark_result(&aggregate);
+		write_benchmark_json(json, name, &aggregate);
+	}
+
+	/* Instructions are compared per iteration, as the number of iterations varies */
+	if (config->perf_counters_mode != RKTEST_PERF_COUNTERS_OFF && aggregate.num_iterations > 0) {
+		uint64_t perf_counts[RKTEST_PERF_MAX_COUNTERS];
+		for (size_t i = 0; i < RKTEST_PERF_MAX_COUNTERS; i++) {
+			perf_counts[i] = aggregate.perf_counts[i] / aggregate.num_iterations;
+		}
+		check_perf_counts(name, perf_counts, config);
+	}
+	histogram_free(&aggregate.histogram);
+	vec_free(repetitions);
+}
+
+static void run_benchmark(const rktest_test_t* benchmark, const rktest_config_t* config, rktest_bench_fixture_t* fixture, rktest_benchmark_json_t* json) {
+	char name[RKTEST_MAX_TEST_NAME_LENGTH];
+	if (benchmark->num_bench_args == 0) {
+		format_full_test_name(name, sizeof(name), benchmark);
+		run_benchmark_with_arg(benchmark, name, config, 0, json);
+		return;
+	}
+
+	for (size_t i = 0; i < benchmark->num_bench_args; i++) {
+		const int64_t arg = benchmark->bench_args[i];
+		snprintf(name, sizeof(name), "%s.%s/%lld", benchmark->suite_name, benchmark->test_name, (long long)arg);
+		setup_benchmark_fixture(fixture, benchmark, arg);
+		run_benchmark_with_arg(benchmark, name, config, arg, json);
+	}
+}
+
+static int run_all_benchmarks(const rktest_environment_t* env, const rktest_config_t* config) {
+	rktest_benchmark_json_t json = { 0 };
+	if (*config->benchmark_json_path) {
+		json.file = fopen(config->benchmark_json_path, "w");
+		if (!json.file) {
+			fprintf(stderr, "Error: could not open %s for writing\n", config->benchmark_json_path);
+			return 1;
+		}
+		fprintf(json.file, "{\n  \"benchmarks\": [");
+	}
+
+	rktest_printf_yellow("Note: Benchmark filter = %s\n", config->benchmark_filter);
+	rktest_log_info("[==========] ", "Running %zu benchmarks.\n", vec_len(env->benchmarks));
+	rktest_timer_t total_time_timer = rktest_timer_start();
+	rktest_bench_fixture_t fixture = { 0 };
+	vec_foreach(const rktest_test_t*, benchmark, env->benchmarks) {
+		run_benchmark(benchmark, config, &fixture, &json);
+	}
+	teardown_benchmark_fixture(&fixture);
+	rktest_millis_t total_time_ms = rktest_timer_stop(&total_time_timer);
+	rktest_log_info("[==========] ", "%zu benchmarks ran. ", vec_len(env->benchmarks));
+	if (config->print_timestamps_enabled) {
+		printf("(%d ms total)", total_time_ms);
+	}
+	printf("\n");
+
+	if (json.file) {
+		fprintf(json.file, "\n  ]\n}\n");
+		fclose(json.file);
+	}
+	return g_perf.num_regressions > 0 || g_benchmark_failed;
+}
+
 static void print_failed_tests(rktest_report_t* report) {
 	rktest_log_error("[  FAILED  ] ", "%zu tests, listed below:\n", vec_len(report->failed_tests));
 	vec_foreach(const rktest_test_t*, failed_test, report->failed_tests) {
@@ -1173,8 +6463,16 @@ static void print_failed_tests(rktest_report_t* report) {
 	printf(" %zu FAILED TEST%s\n", vec_len(report->failed_tests), vec_len(report->failed_tests) > 1 ? "S" : "");
 }
 
+static void print_skipped_tests(rktest_report_t* report) {
+	rktest_log_warning("[  SKIPPED ] ", "%zu tests, listed below:\n", vec_len(report->skipped_tests));
+	vec_foreach(const rktest_test_t*, skipped_test, report->skipped_tests) {
+		rktest_log_warning("[  SKIPPED ] ", "%s.%s\n", skipped_test->suite_name, skipped_test->test_name);
+	}
+}
+
 static void free_test_report(rktest_report_t* report) {
 	vec_free(report->failed_tests);
+	vec_free(report->skipped_tests);
 }
 
 static void free_test_env(rktest_environment_t* env) {
@@ -1182,11 +6480,32 @@ static void free_test_env(rktest_environment_t* env) {
 		vec_free(suite->tests);
 	}
 	vec_free(env->test_suites);
+	vec_free(env->benchmarks);
+	vec_free(env->benchmark_fixtures);
+	vec_foreach(char**, name, env->instance_names) {
+		free(*name);
+	}
+	vec_free(env->instance_names);
+	vec_free(g_probes);
+	free_registered_tests();
+	free_cached_data();
+	free_shared_allocations();
 }
 
 int rktest_main(int argc, const char* argv[]) {
 	rktest_config_t config = initialize(argc, argv);
 	rktest_environment_t env = setup_test_env(&config);
+	if (!start_perf(&config)) {
+		free_test_env(&env);
+		return 1;
+	}
+
+	if (*config.benchmark_filter) {
+		const int result = run_all_benchmarks(&env, &config);
+		end_perf(&config);
+		free_test_env(&env);
+		return result;
+	}
 
 	if (*config.test_filter) {
 		rktest_printf_yellow("Note: Test filter = %s\n", config.test_filter);
@@ -1205,6 +6524,9 @@ int rktest_main(int argc, const char* argv[]) {
 	}
 	printf("\n");
 	rktest_log_info("[  PASSED  ] ", "%zu tests.\n", report.num_passed_tests);
+	if (vec_len(report.skipped_tests) > 0) {
+		print_skipped_tests(&report);
+	}
 
 	const bool tests_failed = vec_len(report.failed_tests) > 0;
 	if (tests_failed) {
@@ -1218,6 +6540,7 @@ int rktest_main(int argc, const char* argv[]) {
 		rktest_printf_yellow("  YOU HAVE %zu DISABLED TEST%s\n", env.total_num_disabled_tests, env.total_num_disabled_tests > 1 ? "S" : "");
 	}
 
+	end_perf(&config);
 	free_test_report(&report);
 	free_test_env(&env);
 
@@ -0,0 +1,174 @@
+#include <rktest/rktest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t fnv1a_hash(const char* str) {
+	uint32_t hash = 2166136261u;
+	for (; *str; str++) {
+		hash = (hash ^ (uint8_t)*str) * 16777619u;
+	}
+	return hash;
+}
+
+BENCHMARK(benchmark_tests, hash_string) {
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+BENCHMARK(benchmark_tests, hash_string_batched) {
+	rktest_bench_set_batch_size(bench, 64);
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+static uint32_t hash_many_strings(void) {
+	uint32_t hash = 0;
+	for (int i = 0; i < 1000; i++) {
+		hash ^= fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+	return hash;
+}
+
+BENCHMARK(benchmark_tests, hash_string_paused_setup) {
+	while (rktest_bench_loop(bench)) {
+		rktest_bench_pause(bench);
+		uint32_t seed = hash_many_strings();
+		RKTEST_DO_NOT_OPTIMIZE(seed);
+		rktest_bench_resume(bench);
+
+		uint32_t hash = fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+BENCHMARK(benchmark_tests, hash_string_batched_setup) {
+	char inputs[64][16];
+	while (rktest_bench_batch_setup(bench, 64)) {
+		for (int i = 0; i < 64; i++) {
+			uint32_t seed = hash_many_strings();
+			snprintf(inputs[i], sizeof(inputs[i]), "%08x", (unsigned)seed + i);
+		}
+		rktest_bench_batch_start(bench);
+		for (int i = 0; i < 64; i++) {
+			uint32_t hash = fnv1a_hash(inputs[i]);
+			RKTEST_DO_NOT_OPTIMIZE(hash);
+		}
+	}
+}
+
+#ifdef RKTEST_FAILING_TESTS
+BENCHMARK(benchmark_tests, batch_never_started) {
+	while (rktest_bench_batch_setup(bench, 64)) {
+		uint32_t hash = fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+#endif
+
+BENCHMARK_RATE(benchmark_tests, hash_many_strings, 1000) {
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = hash_many_strings();
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+static char* g_input;
+
+BENCHMARK_SETUP(fixture_benchmarks) {
+	printf("Setting up input of size %lld\n", (long long)arg);
+	g_input = malloc((size_t)arg + 1);
+	memset(g_input, 'a', (size_t)arg);
+	g_input[arg] = '\0';
+}
+
+BENCHMARK_TEARDOWN(fixture_benchmarks) {
+	printf("Tearing down input of size %lld\n", (long long)arg);
+	free(g_input);
+	g_input = NULL;
+}
+
+BENCHMARK_F(fixture_benchmarks, hash_input, 16, 4096) {
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = fnv1a_hash(g_input);
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+BENCHMARK_F(fixture_benchmarks, hash_input_twice, 4096) {
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = fnv1a_hash(g_input) ^ fnv1a_hash(g_input + rktest_bench_arg(bench) / 2);
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+#define SUM_ARRAY(T)                           \
+	T values[1024];                            \
+	for (int i = 0; i < 1024; i++) {           \
+		values[i] = (T)(i % 100);              \
+	}                                          \
+	while (rktest_bench_loop(bench)) {         \
+		T sum = 0;                             \
+		for (int i = 0; i < 1024; i++) {       \
+			sum += values[i];                  \
+		}                                      \
+		RKTEST_DO_NOT_OPTIMIZE(sum);           \
+	}
+
+TYPED_BENCHMARK(typed_benchmarks, sum_array, RKTEST_NUMERIC_TYPES, SUM_ARRAY)
+
+static int g_num_runs = 0;
+
+BENCHMARK(isolation_benchmarks, count_runs) {
+	printf("Run number %d\n", ++g_num_runs);
+	while (rktest_bench_loop(bench)) {
+		uint32_t hash = fnv1a_hash("hello world");
+		RKTEST_DO_NOT_OPTIMIZE(hash);
+	}
+}
+
+BENCHMARK(alignment_benchmarks, sum_bytes) {
+	uint8_t* buffer = rktest_bench_buffer(bench, 4096);
+	printf("Buffer offset %d\n", (int)((uintptr_t)buffer % 4096));
+	memset(buffer, 1, 4096);
+	while (rktest_bench_loop(bench)) {
+		uint32_t sum = 0;
+		for (int i = 0; i < 4096; i++) {
+			sum += buffer[i];
+		}
+		RKTEST_DO_NOT_OPTIMIZE(sum);
+	}
+}
+
+static uint64_t sum_pages(const uint8_t* bytes, size_t size) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < size; i += 4096) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+BENCHMARK(memory_benchmarks, sum_prefaulted_huge_pages) {
+	const size_t size = 8 << 20;
+	uint8_t* bytes = rktest_bench_alloc(bench, size, RKTEST_ALLOC_PREFAULT | RKTEST_ALLOC_HUGE_PAGES);
+	while (rktest_bench_loop(bench)) {
+		uint64_t sum = sum_pages(bytes, size);
+		RKTEST_DO_NOT_OPTIMIZE(sum);
+	}
+}
+
+BENCHMARK(memory_benchmarks, sum_hugetlb_on_numa_node) {
+	const size_t size = 4 << 20;
+	uint8_t* bytes = rktest_bench_alloc(bench, size, RKTEST_ALLOC_PREFAULT | RKTEST_ALLOC_HUGETLB | RKTEST_ALLOC_NUMA_NODE(0));
+	while (rktest_bench_loop(bench)) {
+		uint64_t sum = sum_pages(bytes, size);
+		RKTEST_DO_NOT_OPTIMIZE(sum);
+	}
+}
@@ -0,0 +1,72 @@
+#include <rktest/rktest.h>
+
+#include <stdint.h>
+
+#define NUM_VALUES 100000
+
+static int g_num_generated = 0;
+
+static uint32_t value_at(uint32_t i) {
+	return i * 2654435761u;
+}
+
+static void generate_values(FILE* file) {
+	g_num_generated++;
+	for (uint32_t i = 0; i < NUM_VALUES; i++) {
+		const uint32_t value = value_at(i);
+		fwrite(&value, sizeof(value), 1, file);
+	}
+}
+
+TEST(cached_data_tests, returns_generated_data) {
+	size_t size = 0;
+	const uint32_t* values = rktest_cached_data("values", 1, generate_values, &size);
+	ASSERT_TRUE(values != NULL);
+	ASSERT_EQ(size, NUM_VALUES * sizeof(uint32_t));
+
+	size_t num_mismatches = 0;
+	for (uint32_t i = 0; i < NUM_VALUES; i++) {
+		num_mismatches += values[i] != value_at(i);
+	}
+	EXPECT_EQ(num_mismatches, 0);
+}
+
+TEST(cached_data_tests, returns_same_data_for_same_key) {
+	size_t size = 0;
+	size_t size_again = 0;
+	const void* data = rktest_cached_data("values", 1, generate_values, &size);
+	const void* data_again = rktest_cached_data("values", 1, generate_values, &size_again);
+	EXPECT_TRUE(data == data_again);
+	EXPECT_EQ(size, size_again);
+	EXPECT_LE(g_num_generated, 1);
+}
+
+TEST(cached_data_tests, caches_versions_separately) {
+	size_t size = 0;
+	size_t other_size = 0;
+	const void* data = rktest_cached_data("versioned_values", 1, generate_values, &size);
+	const void* other_data = rktest_cached_data("versioned_values", 2, generate_values, &other_size);
+	EXPECT_TRUE(data != other_data);
+	EXPECT_EQ(size, other_size);
+#ifdef RKTEST_FAILING_TESTS
+	EXPECT_EQ(size, 0);
+#endif
+}
+
+static void generate_other_values(FILE* file) {
+	for (uint32_t i = 0; i < NUM_VALUES; i++) {
+		const uint32_t value = ~value_at(i);
+		fwrite(&value, sizeof(value), 1, file);
+	}
+}
+
+TEST(cached_data_tests, caches_keys_with_same_file_name_separately) {
+	size_t size = 0;
+	size_t other_size = 0;
+	const uint32_t* values = rktest_cached_data("dir/values", 1, generate_values, &size);
+	const uint32_t* other_values = rktest_cached_data("dir_values", 1, generate_other_values, &other_size);
+	ASSERT_TRUE(values != NULL && other_values != NULL);
+	ASSERT_EQ(size, other_size);
+	EXPECT_EQ(values[1], value_at(1));
+	EXPECT_EQ(other_values[1], ~value_at(1));
+}
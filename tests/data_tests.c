@@ -0,0 +1,61 @@
+#include <rktest/rktest.h>
+
+#include <stdio.h>
+
+static void copy_record(char* buf, size_t buf_size, const rktest_record_t* record) {
+	snprintf(buf, buf_size, "%.*s", (int)record->size, record->data);
+}
+
+TEST_DATA(data_tests, adds_csv_rows, "data/sums.csv") {
+	char row[64];
+	copy_record(row, sizeof(row), record);
+	int a = 0;
+	int b = 0;
+	int sum = 0;
+	ASSERT_EQ(sscanf(row, "%d,%d,%d", &a, &b, &sum), 3);
+	EXPECT_EQ(a + b, sum);
+}
+
+TEST_DATA(data_tests, measures_jsonl_words, "data/words.jsonl") {
+	char line[64];
+	copy_record(line, sizeof(line), record);
+	char word[32] = { 0 };
+	int length = -1;
+	ASSERT_EQ(sscanf(line, "{\"word\": \"%31[^\"]\", \"length\": %d}", word, &length), 2);
+	EXPECT_EQ((int)strlen(word), length);
+}
+
+TEST_DATA(data_tests, records_point_into_file, "data/words.jsonl") {
+	EXPECT_GT(record->size, 0);
+	EXPECT_EQ(record->data[0], '{');
+	EXPECT_EQ(record->data[record->size - 1], '}');
+}
+
+static int g_num_suite_setups = 0;
+
+SUITE_SETUP(data_tests) {
+	g_num_suite_setups++;
+}
+
+TEST_DATA(data_tests, shards_share_suite_setup, "data/words.jsonl") {
+	(void)record;
+	EXPECT_EQ(g_num_suite_setups, 1);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+
+TEST_DATA(data_tests, fails_one_record, "data/failing_sums.csv") {
+	char row[64];
+	copy_record(row, sizeof(row), record);
+	int a = 0;
+	int b = 0;
+	int sum = 0;
+	ASSERT_EQ(sscanf(row, "%d,%d,%d", &a, &b, &sum), 3);
+	EXPECT_EQ(a + b, sum);
+}
+
+TEST_DATA(data_tests, fails_missing_file, "data/missing.jsonl") {
+	(void)record;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include <rktest/rktest.h>
+
+static int stored_value;
+
+/* Defined before its prerequisite, which still runs first */
+TEST_DEPENDS(dependency_tests, reads_back_value, "dependency_tests.stores_value") {
+	EXPECT_EQ(stored_value, 42);
+}
+
+TEST(dependency_tests, stores_value) {
+	stored_value = 42;
+#ifdef RKTEST_FAILING_TESTS
+	EXPECT_EQ(stored_value, 43);
+#endif
+}
+
+TEST_DEPENDS(dependency_tests, reads_back_value_twice, "dependency_tests.reads_back_value") {
+	EXPECT_EQ(stored_value, 42);
+	EXPECT_EQ(stored_value, 42);
+}
+
+TEST_DEPENDS(dependency_tests, runs_without_failed_prerequisites, "dependency_tests.stores_value", "dependency_tests.reads_back_value") {
+	EXPECT_TRUE(true);
+}
+
+TEST(dependency_tests, DISABLED_stores_other_value) {
+	stored_value = 43;
+}
+
+TEST_DEPENDS(dependency_tests, skipped_with_disabled_prerequisite, "dependency_tests.DISABLED_stores_other_value") {
+	EXPECT_EQ(stored_value, 43);
+}
+
+static int g_num_isa_instances_run = 0;
+static rktest_isa_t g_last_isa_instance = RKTEST_ISA_SCALAR;
+
+/* Defined before its prerequisite, which runs once per level up to the last one */
+TEST_DEPENDS(dependency_tests, runs_after_every_isa_instance, "dependency_tests.counts_isa_instances") {
+	EXPECT_EQ(g_num_isa_instances_run, (int)g_last_isa_instance + 1);
+}
+
+TEST_ISA(dependency_tests, counts_isa_instances) {
+	g_num_isa_instances_run++;
+	g_last_isa_instance = rktest_current_isa();
+}
+
+/* Split into instances by --rktest_shards */
+TEST_DEPENDS(dependency_tests, runs_after_every_shard, "dependency_tests.reads_words") {
+	EXPECT_TRUE(true);
+}
+
+TEST_DATA(dependency_tests, reads_words, "data/words.jsonl") {
+	EXPECT_GT(record->size, 0);
+}
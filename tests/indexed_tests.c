@@ -0,0 +1,45 @@
+#include <rktest/rktest.h>
+
+#include <stdio.h>
+
+static uint32_t rotate_left(uint32_t value, int shift) {
+	return shift == 0 ? value : (value << shift) | (value >> (32 - shift));
+}
+
+static uint32_t rotate_right(uint32_t value, int shift) {
+	return shift == 0 ? value : (value >> shift) | (value << (32 - shift));
+}
+
+static void format_rotation_name(char* buf, size_t size, uint64_t index) {
+	snprintf(buf, size, "shift_%d_of_%u", (int)(index % 32), (unsigned)(index / 32));
+}
+
+TEST_INDEXED(indexed_tests, rotates_back, 32ull << 12, &format_rotation_name) {
+	const uint32_t value = (uint32_t)(index / 32) * 2654435761u;
+	const int shift = (int)(index % 32);
+	EXPECT_EQ(rotate_right(rotate_left(value, shift), shift), value);
+}
+
+TEST_INDEXED(indexed_tests, runs_indices_below_count, 1000, NULL) {
+	EXPECT_LT(index, 1000u);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+
+TEST_INDEXED(indexed_tests, fails_one_instance, 32ull << 6, &format_rotation_name) {
+	const uint32_t value = (uint32_t)(index / 32);
+	const int shift = (int)(index % 32);
+	const uint32_t rotated = shift == 0 ? value : (value << shift) | (value >> (31 - shift));
+	if (value == 17 && shift == 3) {
+		EXPECT_EQ(rotated, rotate_left(value, shift) + 1);
+	}
+}
+
+TEST_INDEXED(indexed_tests, skips_instance, 10, NULL) {
+	if (index == 7) {
+		RKTEST_SKIP("index 7 is not supported");
+	}
+	ASSERT_LT(index, 9);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include <rktest/rktest.h>
+
+#include <stddef.h>
+
+/* Stand-in for a kernel dispatching at runtime on the instruction set level */
+static rktest_isa_t dispatch_level = RKTEST_ISA_SCALAR;
+static rktest_isa_t last_used_level = RKTEST_ISA_SCALAR;
+
+static int sum_ints(const int* values, size_t count) {
+	last_used_level = dispatch_level;
+	int sum = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += values[i];
+	}
+#ifdef RKTEST_FAILING_TESTS
+	/* Bug only present in the scalar path */
+	if (dispatch_level == RKTEST_ISA_SCALAR) {
+		sum -= values[count - 1];
+	}
+#endif
+	return sum;
+}
+
+RKTEST_ISA_HOOK(isa) {
+	dispatch_level = isa;
+}
+
+TEST_ISA(isa_tests, sums_ints) {
+	const int values[] = { 1, 2, 3, 4 };
+	EXPECT_EQ(sum_ints(values, 4), 10);
+}
+
+TEST_ISA(isa_tests, dispatches_to_overridden_level) {
+	const int values[] = { 1 };
+	sum_ints(values, 1);
+	EXPECT_EQ((int)last_used_level, (int)rktest_current_isa());
+}
@@ -0,0 +1,50 @@
+#include <rktest/rktest.h>
+
+#include <stdio.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+TEST(leak_tests, closed_file_is_not_a_leak) {
+	FILE* file = fopen(__FILE__, "r");
+	EXPECT_TRUE(file != NULL);
+	if (file) {
+		fclose(file);
+	}
+}
+
+#ifdef __linux__
+static void* return_immediately(void* arg) {
+	return arg;
+}
+
+TEST(leak_tests, joined_thread_is_not_a_leak) {
+	pthread_t thread;
+	ASSERT_EQ(pthread_create(&thread, NULL, &return_immediately, NULL), 0);
+	EXPECT_EQ(pthread_join(thread, NULL), 0);
+}
+#endif
+
+#if defined(RKTEST_FAILING_TESTS) && defined(__linux__)
+static FILE* g_file = NULL;
+
+static void* wait_forever(void* arg) {
+	while (true) {
+		pause();
+	}
+	return arg;
+}
+
+TEST(leak_tests, opened_file_is_a_leak) {
+	g_file = fopen("/dev/null", "r");
+	EXPECT_TRUE(g_file != NULL);
+}
+
+TEST(leak_tests, running_thread_is_a_leak) {
+	pthread_t thread;
+	ASSERT_EQ(pthread_create(&thread, NULL, &wait_forever, NULL), 0);
+	pthread_detach(thread);
+}
+#endif
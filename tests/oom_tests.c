@@ -0,0 +1,90 @@
+#include <rktest/rktest.h>
+
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+typedef struct {
+	int* first;
+	int* second;
+} int_pair_t;
+
+static bool int_pair_init(int_pair_t* pair) {
+	pair->first = malloc(sizeof(int));
+	if (!pair->first) {
+		return false;
+	}
+	pair->second = malloc(sizeof(int));
+	if (!pair->second) {
+#ifndef RKTEST_FAILING_TESTS
+		free(pair->first);
+#endif
+		return false;
+	}
+	return true;
+}
+
+static void int_pair_free(int_pair_t* pair) {
+	free(pair->first);
+	free(pair->second);
+}
+
+static int* new_int(int value) {
+	int* ptr = malloc(sizeof(int));
+#ifndef RKTEST_FAILING_TESTS
+	if (!ptr) {
+		return NULL;
+	}
+#else
+	if (!ptr) {
+		abort();
+	}
+#endif
+	*ptr = value;
+	return ptr;
+}
+
+TEST(oom_tests, failed_allocations_are_freed) {
+	int_pair_t pair;
+	if (int_pair_init(&pair)) {
+		int_pair_free(&pair);
+	}
+}
+
+TEST(oom_tests, failed_allocations_are_checked) {
+	int* ptr = new_int(123);
+	if (ptr) {
+		EXPECT_EQ(*ptr, 123);
+	}
+	free(ptr);
+}
+
+TEST(oom_tests, subtest_allocations_are_failed) {
+	RKTEST_SUBTEST("first") {
+		int* ptr = new_int(1);
+		free(ptr);
+	}
+	RKTEST_SUBTEST("second") {
+		int* ptr = new_int(2);
+		free(ptr);
+	}
+}
+
+#ifdef __linux__
+static void* allocate_on_thread(void* arg) {
+	void* ptr = malloc(16);
+	*(bool*)arg = ptr != NULL;
+	free(ptr);
+	return NULL;
+}
+
+TEST(oom_tests, other_threads_are_not_failed) {
+	bool allocated = false;
+	pthread_t thread;
+	ASSERT_EQ(pthread_create(&thread, NULL, allocate_on_thread, &allocated), 0);
+	pthread_join(thread, NULL);
+	EXPECT_TRUE(allocated);
+}
+#endif
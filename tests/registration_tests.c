@@ -0,0 +1,53 @@
+#include <rktest/rktest.h>
+
+#include <stdio.h>
+
+typedef struct {
+	int lhs;
+	int rhs;
+	int product;
+} product_case_t;
+
+static const product_case_t g_product_cases[] = {
+	{ 2, 3, 6 },
+	{ -4, 5, -20 },
+	{ 0, 7, 0 },
+#ifdef RKTEST_FAILING_TESTS
+	{ 3, 3, 10 },
+#endif
+};
+
+static void multiplies(void* context) {
+	const product_case_t* product_case = context;
+	EXPECT_EQ(product_case->lhs * product_case->rhs, product_case->product);
+}
+
+static int g_num_context_runs = 0;
+
+static void increments_context(void* context) {
+	int* num_runs = context;
+	(*num_runs)++;
+	EXPECT_EQ(*num_runs, 1);
+}
+
+RKTEST_REGISTRATION_HOOK(registration_tests) {
+	for (size_t i = 0; i < sizeof(g_product_cases) / sizeof(g_product_cases[0]); i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "multiplies_%d_by_%d", g_product_cases[i].lhs, g_product_cases[i].rhs);
+		rktest_register_test("registration_tests", name, &multiplies, (void*)&g_product_cases[i]);
+	}
+	rktest_register_test("registration_tests", "passes_context", &increments_context, &g_num_context_runs);
+	rktest_register_test("registration_tests", "DISABLED_is_disabled", &increments_context, &g_num_context_runs);
+}
+
+TEST(registration_tests, runs_with_registered_tests) {
+	EXPECT_EQ(g_product_cases[0].product, 6);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+
+TEST(registration_tests, can_not_register_from_test) {
+	rktest_register_test("registration_tests", "too_late", &increments_context, &g_num_context_runs);
+}
+
+#endif
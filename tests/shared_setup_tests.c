@@ -0,0 +1,64 @@
+#include <rktest/rktest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TABLE_SIZE 4096
+
+static const uint32_t* g_squares;
+static int g_num_shared_setups = 0;
+
+SHARED_SETUP(shared_setup_tests) {
+	g_num_shared_setups++;
+	uint32_t* squares = rktest_shared_alloc(TABLE_SIZE * sizeof(uint32_t));
+	for (uint32_t i = 0; squares && i < TABLE_SIZE; i++) {
+		squares[i] = i * i;
+	}
+	g_squares = squares;
+}
+
+TEST(shared_setup_tests, reads_shared_table) {
+	ASSERT_TRUE(g_squares != NULL);
+	EXPECT_EQ(g_squares[12], 144);
+	EXPECT_EQ(g_squares[TABLE_SIZE - 1], (TABLE_SIZE - 1) * (TABLE_SIZE - 1));
+}
+
+TEST(shared_setup_tests, runs_shared_setup_once) {
+	EXPECT_EQ(g_num_shared_setups, 1);
+}
+
+#ifdef __linux__
+/* Also run by a worker with --rktest_jobs, which should see the same pages */
+TEST(shared_setup_tests, table_is_read_only_and_shared) {
+	ASSERT_TRUE(g_squares != NULL);
+	FILE* maps = fopen("/proc/self/maps", "r");
+	ASSERT_TRUE(maps != NULL);
+	char permissions[8] = "";
+	unsigned long long begin = 0;
+	unsigned long long end = 0;
+	char line[512];
+	while (fgets(line, sizeof(line), maps)) {
+		if (sscanf(line, "%llx-%llx %7s", &begin, &end, permissions) == 3 && begin <= (uintptr_t)g_squares && (uintptr_t)g_squares < end) {
+			break;
+		}
+		permissions[0] = '\0';
+	}
+	fclose(maps);
+	EXPECT_STREQ(permissions, "r--s");
+}
+#endif
+
+#ifdef RKTEST_FAILING_TESTS
+TEST(shared_setup_tests, allocates_outside_shared_setup) {
+	EXPECT_TRUE(rktest_shared_alloc(16) != NULL);
+}
+
+/* Fails the tests of its own suite, not the first test to run afterwards */
+SHARED_SETUP(failing_shared_setup_tests) {
+	ASSERT_TRUE(false);
+}
+
+TEST(failing_shared_setup_tests, is_not_run) {
+	EXPECT_TRUE(true);
+}
+#endif
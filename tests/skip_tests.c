@@ -0,0 +1,51 @@
+#include <rktest/rktest.h>
+
+static int num_available_probes_run;
+
+RKTEST_PROBE(always_available) {
+	num_available_probes_run++;
+	return true;
+}
+
+RKTEST_PROBE(never_available) {
+	return false;
+}
+
+TEST(skip_tests, skips_explicitly) {
+	RKTEST_SKIP("not supported on this machine");
+	EXPECT_TRUE(false);
+}
+
+TEST(skip_tests, requires_available_probe) {
+	RKTEST_REQUIRE(always_available);
+	EXPECT_EQ(num_available_probes_run, 1);
+}
+
+TEST(skip_tests, reuses_cached_probe_result) {
+	RKTEST_REQUIRE(always_available);
+	EXPECT_EQ(num_available_probes_run, 1);
+}
+
+TEST(skip_tests, requires_unavailable_probe) {
+	RKTEST_REQUIRE(never_available);
+	EXPECT_TRUE(false);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+TEST(skip_tests, fails_before_skipping) {
+	EXPECT_EQ(1, 2);
+	RKTEST_SKIP("failures are still reported");
+}
+
+TEST(skip_tests, requires_undefined_probe) {
+	RKTEST_REQUIRE(undefined_probe);
+}
+#endif
+
+TEST_SETUP(skipped_suite_tests) {
+	RKTEST_REQUIRE(never_available);
+}
+
+TEST(skipped_suite_tests, is_skipped_by_setup) {
+	EXPECT_TRUE(false);
+}
@@ -1,24 +1,35 @@
+import json
 import os
+import re
 import subprocess
+import sys
+
+import pytest
 
 TEST_EXECUTABLE = './build/Debug/tests' if os.name == 'nt' else './build/tests'
 FAILING_TEST_EXECUTABLE = './build/Debug/failing_tests' if os.name == 'nt' else './build/failing_tests'
 
 
+# TEST_ISA() tests run once per level the machine supports, so snapshots of them only run the scalar level
+SCALAR_ONLY = ['--rktest_isa_max=scalar']
+ISA_LEVELS = ['scalar', 'sse4.2', 'avx2', 'avx512']
+
+
 def run_test_exe(exe, args: [str] = []) -> str:
     result = subprocess.run([exe, '--rktest_print_time=0', '--rktest_print_filenames=0',
                             '--rktest_color=no'] + args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
     print('cmd:', ' '.join(result.args))
-    return result.stdout
+    # Data paths are resolved against the tests directory given by the build
+    return result.stdout.replace(os.getcwd().replace('\\', '/') + '/', '')
 
 
 def test_no_args(snapshot):
-    actual = run_test_exe(TEST_EXECUTABLE)
+    actual = run_test_exe(TEST_EXECUTABLE, SCALAR_ONLY)
     assert actual == snapshot
 
 
 def test_wildcard_match(snapshot):
-    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*'])
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*'] + SCALAR_ONLY)
     assert actual == snapshot
 
 
@@ -33,12 +44,12 @@ def test_prefix_match(snapshot):
 
 
 def test_infix_match(snapshot):
-    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*tests*'])
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*tests*'] + SCALAR_ONLY)
     assert actual == snapshot
 
 
 def test_failing_tests(snapshot):
-    actual = run_test_exe(FAILING_TEST_EXECUTABLE)
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, SCALAR_ONLY)
     assert actual == snapshot
 
 
@@ -50,3 +61,403 @@ def test_print_help(snapshot):
 def test_pass_bad_arg(snapshot):
     actual = run_test_exe(TEST_EXECUTABLE, ['--badargument'])
     assert actual == snapshot
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='leak checking is only supported on Linux')
+def test_leak_check(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=leak_tests.*', '--rktest_leak_check=fail'])
+    assert re.sub(r'Leaked thread \d+', 'Leaked thread <tid>', actual) == snapshot
+
+
+def test_progress_only_prints_failing_tests():
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_progress=yes'])
+    assert '[ RUN      ] float_tests.float_equal \n' in actual
+    assert '[  FAILED  ] float_tests.float_equal \n' in actual
+    assert 'disabled_tests.this_test_should_run' not in actual
+    assert '[       OK ]' not in actual
+
+
+def test_progress_fails_tests_of_failed_suite_setup():
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_progress=yes', '--rktest_filter=failing_suite_setup_tests.*'])
+    assert '[  FAILED  ] failing_suite_setup_tests.is_not_run\n' in actual
+
+
+def test_progress_estimates_time_left_from_saved_durations(tmp_path):
+    args = ['--rktest_progress=yes', '--rktest_filter=integer_tests.*', f'--rktest_cache_dir={tmp_path}']
+    durations_path = tmp_path / 'durations'
+    run_test_exe(TEST_EXECUTABLE, args)
+    durations = dict(line.split() for line in durations_path.read_text().splitlines())
+    assert len(durations) > 1
+    assert all(name.startswith('integer_tests.') for name in durations)
+
+    # A test that took ten minutes last time makes the first estimate ten minutes
+    slow_test = sorted(durations)[0]
+    durations_path.write_text(''.join(f'{name} {600_000_000 if name == slow_test else 0}\n' for name in durations))
+    actual = run_test_exe(TEST_EXECUTABLE, args)
+    assert '0 failed, ETA 10m00s | ' in actual
+    durations = dict(line.split() for line in durations_path.read_text().splitlines())
+    assert int(durations[slow_test]) < 600_000_000
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='allocation failure sweeps are only supported with glibc')
+def test_oom_sweep(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=oom_tests.*', '--rktest_oom_sweep=oom_tests.*'])
+    assert actual == snapshot
+
+
+def test_benchmark_histogram_json(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=benchmark_tests.*',
+                          '--rktest_benchmark_min_time=0.01', f'--rktest_benchmark_json={json_path}'])
+    assert '[     DONE ] benchmark_tests.hash_string \n' in actual
+    benchmarks = json.loads(json_path.read_text())['benchmarks']
+    assert [b['name'] for b in benchmarks] == ['benchmark_tests.hash_string', 'benchmark_tests.hash_string_batched',
+                                               'benchmark_tests.hash_string_paused_setup',
+                                               'benchmark_tests.hash_string_batched_setup',
+                                               'benchmark_tests.hash_many_strings']
+    assert benchmarks[4]['target_ops_per_sec'] == 1000
+    for b in benchmarks:
+        assert b['iterations'] > 0
+        assert b['min_ns'] <= b['p50_ns'] <= b['p90_ns'] <= b['p99_ns'] <= b['p999_ns'] <= b['max_ns']
+        assert sum(count for _, _, count in b['histogram']) == b['iterations']
+
+
+def test_benchmark_untimed_setup(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=benchmark_tests.*',
+                 '--rktest_benchmark_min_time=0.01', f'--rktest_benchmark_json={json_path}'])
+    benchmarks = {b['name']: b for b in json.loads(json_path.read_text())['benchmarks']}
+    setup_ns = benchmarks['benchmark_tests.hash_many_strings']['p50_ns']
+    # Hashing one string is far cheaper than the 1000 hashed in the untimed setup
+    assert benchmarks['benchmark_tests.hash_string_paused_setup']['p50_ns'] < setup_ns / 10
+    assert benchmarks['benchmark_tests.hash_string_batched_setup']['p50_ns'] < setup_ns / 10
+
+
+def test_benchmark_batch_never_started():
+    result = subprocess.run([FAILING_TEST_EXECUTABLE, '--rktest_color=no', '--rktest_benchmark=benchmark_tests.batch_never_started',
+                             '--rktest_benchmark_min_time=0.01'], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    assert 'error: rktest_bench_batch_start() was never called after rktest_bench_batch_setup()\n' in result.stdout
+    assert '[  FAILED  ] benchmark_tests.batch_never_started\n' in result.stdout
+    assert result.returncode != 0
+
+
+def test_benchmark_rate_sweep(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=benchmark_tests.hash_many_strings',
+                          '--rktest_benchmark_min_time=0.01', '--rktest_benchmark_rate_sweep=yes',
+                          f'--rktest_benchmark_json={json_path}'])
+    assert 'saturation knee: ' in actual
+    benchmarks = json.loads(json_path.read_text())['benchmarks']
+    targets = [b['target_ops_per_sec'] for b in benchmarks]
+    assert [b['name'] for b in benchmarks] == [f'benchmark_tests.hash_many_strings/rate:{t:.0f}' for t in targets]
+    assert targets == [1000 * 2 ** i for i in range(len(targets))]
+    for b in benchmarks:
+        assert b['min_ns'] <= b['p50_ns'] <= b['p99_ns'] <= b['max_ns']
+
+
+def test_benchmark_fixture_setup_once_per_arg(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=fixture_benchmarks.*', '--rktest_benchmark_min_time=0.01',
+                          '--rktest_benchmark_repetitions=3', f'--rktest_benchmark_json={json_path}'])
+    fixture_lines = [line for line in actual.splitlines() if 'input of size' in line]
+    assert fixture_lines == ['Setting up input of size 16', 'Tearing down input of size 16',
+                             'Setting up input of size 4096', 'Tearing down input of size 4096']
+    names = [b['name'] for b in json.loads(json_path.read_text())['benchmarks']]
+    assert names == [f'fixture_benchmarks.{name}/{arg}{repetition}'
+                     for name, arg in [('hash_input', 16), ('hash_input', 4096), ('hash_input_twice', 4096)]
+                     for repetition in ['/repeat:0', '/repeat:1', '/repeat:2', '']]
+
+
+def test_benchmark_variant_comparison(tmp_path, snapshot):
+    results = {
+        'O2': [('bench.sort', 2_345_678), ('bench.hash', 84), ('bench.copy', 950)],
+        'O3': [('bench.copy', 1_250), ('bench.hash', 80)],
+        'native': [('bench.sort', 1_200_000), ('bench.hash', 84)],
+    }
+    for variant, benchmarks in results.items():
+        (tmp_path / f'variants_{variant}.json').write_text(json.dumps(
+            {'benchmarks': [{'name': name, 'p50_ns': p50_ns} for name, p50_ns in benchmarks]}))
+    result = subprocess.run(['cmake', '-DVARIANTS=O2|O3|native', f'-DJSON_PREFIX={tmp_path}/variants_',
+                             '-P', 'cmake/RKTestCompareBenchmarks.cmake'], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    assert result.returncode == 0
+    assert result.stdout == snapshot
+
+
+def test_test_dependencies(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=dependency_tests.*'])
+    assert actual == snapshot
+
+
+@pytest.mark.parametrize('args', [[], ['--rktest_shards=3'], ['--rktest_jobs=2']])
+def test_prerequisite_with_instances(args):
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=dependency_tests.*'] + args)
+    assert '[       OK ] dependency_tests.runs_after_every_isa_instance' in actual
+    assert '[       OK ] dependency_tests.runs_after_every_shard' in actual
+
+
+def test_filtered_out_prerequisite():
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=dependency_tests.reads_back_value'])
+    assert 'Skipped because prerequisite dependency_tests.stores_value did not pass\n' in actual
+    assert '[  SKIPPED ] dependency_tests.reads_back_value\n' in actual
+
+
+def test_skipped_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=skip*'])
+    assert actual == snapshot
+
+
+def test_isa_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=isa_tests.*'] + SCALAR_ONLY)
+    assert actual == snapshot
+
+
+def test_isa_tests_run_at_every_supported_level():
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=isa_tests.sums_ints*', '--rktest_isa_max=avx512'])
+    levels = [line.split('[')[-1].rstrip(' ]') for line in actual.splitlines() if line.startswith('[       OK ]')]
+    expected = supported_isa_levels()
+    if expected is not None:
+        assert levels == expected
+    else:
+        assert levels[0] == 'scalar'
+        assert levels == sorted(set(levels), key=ISA_LEVELS.index)
+
+
+def supported_isa_levels():
+    """Returns the levels RK Test detects on Linux, where the CPU flags are known, else None"""
+    if not sys.platform.startswith('linux'):
+        return None
+    with open('/proc/cpuinfo') as f:
+        flags = {flag for line in f if line.startswith('flags') for flag in line.split(':', 1)[1].split()}
+    return ['scalar'] + [level for level, flag in [('sse4.2', 'sse4_2'), ('avx2', 'avx2'), ('avx512', 'avx512f')] if flag in flags]
+
+
+def test_exhaustive_sweeps(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=sweep_tests.*'])
+    assert actual == snapshot
+
+
+def test_statistical_assertions(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=statistical_tests.*'])
+    assert actual == snapshot
+
+
+def test_statistical_assertions_p_value_threshold():
+    passing = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=statistical_tests.samples_are_exponential'])
+    failing = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=statistical_tests.samples_are_exponential',
+                                             '--rktest_p_value=0.99999'])
+    assert '[  PASSED  ] 1 tests.' in passing
+    assert 'Threshold: 0.99999' in failing
+
+
+def test_cached_data(tmp_path):
+    args = ['--rktest_filter=cached_data_tests.*', f'--rktest_cache_dir={tmp_path}']
+    first = run_test_exe(TEST_EXECUTABLE, args)
+    [cache_path] = tmp_path.glob('values-*.1.cache')
+    first_mtime = cache_path.stat().st_mtime_ns
+    second = run_test_exe(TEST_EXECUTABLE, args)
+    assert '[  PASSED  ] 4 tests.' in first
+    assert '[  PASSED  ] 4 tests.' in second
+    # Keys that only differ in characters replaced in file names get their own file
+    assert len(list(tmp_path.glob('dir_values-*.1.cache'))) == 2
+    assert cache_path.stat().st_mtime_ns == first_mtime
+
+    # A cache written by another build of the test program is regenerated
+    with open(cache_path, 'r+b') as f:
+        f.seek(8)
+        f.write(b'\0' * 8)
+    third = run_test_exe(TEST_EXECUTABLE, args)
+    assert '[  PASSED  ] 4 tests.' in third
+    assert cache_path.read_bytes()[8:16] != b'\0' * 8
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='allocation failure sweeps are only supported with glibc')
+def test_cached_data_is_not_swept(tmp_path):
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=cached_data_tests.*', '--rktest_oom_sweep=cached_data_tests.*',
+                                            f'--rktest_cache_dir={tmp_path}'])
+    assert '[  PASSED  ] 4 tests.' in actual
+    assert 'Warning: Could not cache' not in actual
+    [cache_path] = tmp_path.glob('values-*.1.cache')
+    assert cache_path.stat().st_size == 64 + 100000 * 4
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+@pytest.mark.parametrize('exe', [TEST_EXECUTABLE, FAILING_TEST_EXECUTABLE])
+def test_jobs_match_single_process_output(exe):
+    assert run_test_exe(exe, ['--rktest_jobs=3']) == run_test_exe(exe)
+
+
+def test_data_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=data_tests.*'])
+    assert actual == snapshot
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+def test_data_shards(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=data_tests.*', '--rktest_shards=2', '--rktest_jobs=2'])
+    assert actual == snapshot
+
+
+def test_data_shard_filter():
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=data_tests.adds_csv_rows[2of3]', '--rktest_shards=3'])
+    assert 'Running 1 tests from 1 test suites' in actual
+    assert '[       OK ] data_tests.adds_csv_rows[2of3]/line_3' in actual
+    assert '[       OK ] data_tests.adds_csv_rows[2of3] ' in actual
+
+
+def test_data_shards_former_option_name():
+    args = ['--rktest_filter=data_tests.*']
+    assert run_test_exe(TEST_EXECUTABLE, args + ['--rktest_data_shards=3']) == run_test_exe(TEST_EXECUTABLE, args + ['--rktest_shards=3'])
+
+
+def test_data_dir(tmp_path):
+    (tmp_path / 'data').mkdir()
+    (tmp_path / 'data' / 'sums.csv').write_text('a,b,sum\n1,1,3\n')
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=data_tests.adds_csv_rows', f'--rktest_data_dir={tmp_path}'])
+    assert '[  FAILED  ] data_tests.adds_csv_rows/line_2' in actual
+
+
+def test_indexed_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=indexed_tests.*'])
+    assert actual == snapshot
+
+
+def test_indexed_test_filter(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=indexed_tests.*/shift_3_of_1*', '--rktest_shards=3'])
+    assert actual == snapshot
+
+
+def test_registered_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=registration_tests.*'])
+    assert actual == snapshot
+
+
+def test_subtests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=subtest_tests.*'])
+    assert actual == snapshot
+
+
+def test_subtest_filter(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=subtest_tests.parses_rows/row_3'])
+    assert actual == snapshot
+
+
+def test_suite_fixtures(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=*suite_*'])
+    assert actual == snapshot
+
+
+def test_pipelined_fixtures_match_sequential_output():
+    pipelined = run_test_exe(TEST_EXECUTABLE, ['--rktest_pipeline_fixtures=yes'])
+    assert pipelined == run_test_exe(TEST_EXECUTABLE)
+
+
+@pytest.mark.skipif(sys.platform != 'linux', reason='overlap test is Linux only')
+def test_pipelined_setup_overlaps_previous_suite():
+    args = ['--rktest_filter=*overlap*']
+    assert '[  FAILED  ] pipelined_fixture_tests.next_suite_setup_overlaps' in run_test_exe(FAILING_TEST_EXECUTABLE, args)
+    pipelined = run_test_exe(FAILING_TEST_EXECUTABLE, args + ['--rktest_pipeline_fixtures=yes'])
+    assert '[       OK ] pipelined_fixture_tests.next_suite_setup_overlaps' in pipelined
+    assert '[       OK ] overlapping_setup_tests.setup_is_done_before_tests' in pipelined
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+def test_pipelining_is_ignored_with_jobs():
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_pipeline_fixtures=yes', '--rktest_jobs=2'])
+    assert 'Warning: --rktest_pipeline_fixtures is ignored' in actual
+
+
+def test_shared_setup(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=*shared_setup_tests.*'])
+    assert actual == snapshot
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+def test_failing_shared_setup_in_workers():
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=*shared_setup_tests.*', '--rktest_jobs=2'])
+    assert '[       OK ] shared_setup_tests.reads_shared_table' in actual
+    assert '[  FAILED  ] failing_shared_setup_tests.is_not_run' in actual
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+def test_shared_setup_in_workers():
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*shared_setup_tests.*', '--rktest_jobs=2'])
+    assert actual == run_test_exe(TEST_EXECUTABLE, ['--rktest_filter=*shared_setup_tests.*'])
+    assert '[  PASSED  ] ' in actual and 'FAILED' not in actual
+
+
+def test_typed_tests(snapshot):
+    actual = run_test_exe(FAILING_TEST_EXECUTABLE, ['--rktest_filter=typed_tests.*'])
+    assert actual == snapshot
+
+
+@pytest.mark.skipif(sys.platform == 'win32', reason='needs fork()')
+@pytest.mark.parametrize('isolation, expected_runs', [('none', [1, 2, 3]), ('process', [1, 1, 1])])
+def test_benchmark_isolation(tmp_path, isolation, expected_runs):
+    json_path = tmp_path / 'benchmarks.json'
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=isolation_benchmarks.*', '--rktest_benchmark_min_time=0.01',
+                          '--rktest_benchmark_repetitions=3', f'--rktest_benchmark_isolation={isolation}',
+                          f'--rktest_benchmark_json={json_path}'])
+    runs = [int(line.split()[-1]) for line in actual.splitlines() if line.startswith('Run number')]
+    assert runs == expected_runs
+    for b in json.loads(json_path.read_text())['benchmarks']:
+        assert b['iterations'] > 0
+        assert sum(count for _, _, count in b['histogram']) == b['iterations']
+
+
+def test_benchmark_alignment_sweep(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    actual = run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=alignment_benchmarks.*', '--rktest_benchmark_min_time=0.001',
+                          '--rktest_benchmark_alignment_sweep=8', f'--rktest_benchmark_json={json_path}'])
+    offsets = [int(line.split()[-1]) for line in actual.splitlines() if line.startswith('Buffer offset')]
+    assert offsets == list(range(0, 64, 8))
+    assert '8 offsets: best p50 ' in actual
+    names = [b['name'] for b in json.loads(json_path.read_text())['benchmarks']]
+    assert names == [f'alignment_benchmarks.sum_bytes/offset:{offset}' for offset in offsets]
+
+
+# Benchmarks without buffers run once per repetition, as without a sweep
+@pytest.mark.parametrize('benchmark, prefix, expected', [('alignment_benchmarks.*', 'Buffer offset', [0, 0, 0, 32, 32, 32]),
+                                                         ('isolation_benchmarks.*', 'Run number', [1, 2, 3])])
+def test_benchmark_alignment_sweep_repetitions(benchmark, prefix, expected):
+    actual = run_test_exe(TEST_EXECUTABLE, [f'--rktest_benchmark={benchmark}', '--rktest_benchmark_min_time=0.001',
+                          '--rktest_benchmark_alignment_sweep=32', '--rktest_benchmark_repetitions=3'])
+    values = [int(line.split()[-1]) for line in actual.splitlines() if line.startswith(prefix)]
+    assert values == expected
+
+
+@pytest.mark.skipif(not sys.platform.startswith('linux'), reason='needs mmap() flags of Linux')
+def test_benchmark_alloc(tmp_path):
+    json_path = tmp_path / 'benchmarks.json'
+    run_test_exe(TEST_EXECUTABLE, ['--rktest_benchmark=memory_benchmarks.*', '--rktest_benchmark_min_time=0.01',
+                 f'--rktest_benchmark_json={json_path}'])
+    benchmarks = json.loads(json_path.read_text())['benchmarks']
+    assert [b['allocated_bytes'] for b in benchmarks] == [8 << 20, 4 << 20]
+    for b in benchmarks:
+        assert b['iterations'] > 0
+        assert 0 <= b['huge_page_bytes'] <= b['allocated_bytes']
+        assert (b['huge_page_bytes'] > 0) == (b['huge_page_size'] > 0)
+
+
+def test_perf_counter_baseline(tmp_path):
+    baseline_path = tmp_path / 'perf.txt'
+    args = ['--rktest_filter=integer_tests.*', '--rktest_perf_counters=instructions']
+    result = subprocess.run([TEST_EXECUTABLE] + args + [f'--rktest_perf_save={baseline_path}'],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if 'hardware performance counters are not available' in result.stdout:
+        # A gate without counters fails instead of silently passing
+        assert result.returncode != 0 and 'Running' not in result.stdout and not baseline_path.exists()
+        baseline_path.write_text('integer_tests.int_equal 1 0 0\n')
+        result = subprocess.run([TEST_EXECUTABLE] + args + [f'--rktest_perf_baseline={baseline_path}'],
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        assert result.returncode != 0 and 'Error: hardware performance counters are not available' in result.stdout
+        pytest.skip('no hardware performance counters')
+
+    entries = [line.split() for line in baseline_path.read_text().splitlines()]
+    assert all(name.startswith('integer_tests.') and int(instructions) > 0 for name, instructions, _, _ in entries)
+
+    actual = run_test_exe(TEST_EXECUTABLE, args + [f'--rktest_perf_baseline={baseline_path}', '--rktest_perf_threshold=50'])
+    assert 'FAILED' not in actual
+
+    baseline_path.write_text(''.join(f'{name} {int(instructions) // 10} 0 0\n' for name, instructions, _, _ in entries))
+    actual = run_test_exe(TEST_EXECUTABLE, args + [f'--rktest_perf_baseline={baseline_path}'])
+    assert f'{len(entries)} FAILED TESTS' in actual
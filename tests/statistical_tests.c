@@ -0,0 +1,88 @@
+#include <rktest/rktest.h>
+
+#include <math.h>
+#include <stdint.h>
+
+/* xorshift64* generator, seeded per batch of samples */
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545f4914f6cdd1dull;
+}
+
+static double next_uniform(uint64_t* state) {
+	return (double)(next_random(state) >> 11) / 9007199254740992.0;
+}
+
+static void sample_bucket_index(double* samples, size_t count, uint64_t seed, void* user_data) {
+	const uint64_t num_buckets = *(const uint64_t*)user_data;
+	uint64_t state = seed | 1;
+	for (size_t i = 0; i < count; i++) {
+#ifndef RKTEST_FAILING_TESTS
+		samples[i] = (double)(next_random(&state) % num_buckets);
+#else
+		/* Low buckets are hit twice as often */
+		samples[i] = (double)(next_random(&state) % (num_buckets + num_buckets / 4) % num_buckets);
+#endif
+	}
+}
+
+/* Knuth's algorithm for Poisson distributed counts */
+static void sample_poisson_occupancy(double* samples, size_t count, uint64_t seed, void* user_data) {
+	const double mean = *(const double*)user_data;
+	uint64_t state = seed | 1;
+	for (size_t i = 0; i < count; i++) {
+		const double limit = exp(-mean);
+		int k = 0;
+		for (double p = next_uniform(&state); p > limit; p *= next_uniform(&state)) {
+			k++;
+		}
+		samples[i] = k < 15 ? k : 15;
+	}
+}
+
+static void sample_exponential(double* samples, size_t count, uint64_t seed, void* user_data) {
+	(void)user_data;
+	uint64_t state = seed | 1;
+	for (size_t i = 0; i < count; i++) {
+		samples[i] = -log(1.0 - next_uniform(&state));
+	}
+}
+
+static double exponential_cdf(double x, void* user_data) {
+	const double rate = *(const double*)user_data;
+	return x < 0.0 ? 0.0 : 1.0 - exp(-rate * x);
+}
+
+TEST(statistical_tests, bucket_indices_are_uniform) {
+	const uint64_t num_buckets = 16;
+	EXPECT_UNIFORM(sample_bucket_index, (void*)&num_buckets, 1000000, 16);
+}
+
+TEST(statistical_tests, bucket_occupancy_is_poisson) {
+	/* Probabilities of 0 to 14 items per bucket, and of 15 or more */
+	const double mean = 3.0;
+	double probabilities[16];
+	double tail = 1.0;
+	for (int k = 0; k < 15; k++) {
+		probabilities[k] = exp(-mean + k * log(mean) - lgamma(k + 1.0));
+		tail -= probabilities[k];
+	}
+	probabilities[15] = tail;
+	EXPECT_CHI_SQUARE(sample_poisson_occupancy, (void*)&mean, 1000000, probabilities, 16);
+}
+
+TEST(statistical_tests, samples_are_exponential) {
+#ifndef RKTEST_FAILING_TESTS
+	const double rate = 1.0;
+#else
+	const double rate = 1.01;
+#endif
+	EXPECT_KOLMOGOROV_SMIRNOV(sample_exponential, NULL, 1000000, exponential_cdf, (void*)&rate);
+}
+
+TEST(statistical_tests, samples_outside_buckets_never_fit) {
+	const uint64_t num_buckets = 17;
+	EXPECT_DOUBLE_EQ(rktest_chi_square_p_value(sample_bucket_index, (void*)&num_buckets, 1000, NULL, 16), 0.0);
+}
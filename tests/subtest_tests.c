@@ -0,0 +1,55 @@
+#include <rktest/rktest.h>
+
+typedef struct {
+	const char* input;
+	int expected;
+} row_t;
+
+static const row_t g_rows[] = {
+	{ "0", 0 },
+	{ "7", 7 },
+	{ "42", 42 },
+#ifdef RKTEST_FAILING_TESTS
+	{ "-1", 1 },
+#endif
+	{ "1000", 1000 },
+};
+
+static int parse_int(const char* str) {
+	int value = 0;
+	int sign = 1;
+	if (*str == '-') {
+		sign = -1;
+		str++;
+	}
+	for (; *str; str++) {
+		value = 10 * value + (*str - '0');
+	}
+	return sign * value;
+}
+
+TEST(subtest_tests, parses_rows) {
+	for (size_t i = 0; i < sizeof(g_rows) / sizeof(g_rows[0]); i++) {
+		RKTEST_SUBTEST("row_%zu", i) {
+			EXPECT_EQ(parse_int(g_rows[i].input), g_rows[i].expected);
+		}
+	}
+}
+
+TEST(subtest_tests, runs_statement_as_subtest) {
+	int num_runs = 0;
+	RKTEST_SUBTEST("increments")
+		num_runs++;
+	EXPECT_EQ(num_runs, 1);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+TEST(subtest_tests, assert_ends_test) {
+	RKTEST_SUBTEST("first") {
+		ASSERT_TRUE(false);
+	}
+	RKTEST_SUBTEST("second") {
+		EXPECT_TRUE(true);
+	}
+}
+#endif
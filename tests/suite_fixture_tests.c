@@ -0,0 +1,96 @@
+#include <rktest/rktest.h>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+static int g_num_suite_setups = 0;
+static int g_num_suite_teardowns = 0;
+static int g_num_tests_run = 0;
+
+SUITE_SETUP(suite_fixture_tests) {
+	g_num_suite_setups++;
+}
+
+SUITE_TEARDOWN(suite_fixture_tests) {
+	g_num_suite_teardowns++;
+	EXPECT_EQ(g_num_tests_run, 2);
+}
+
+TEST(suite_fixture_tests, setup_runs_once_before_first_test) {
+	g_num_tests_run++;
+	EXPECT_EQ(g_num_suite_setups, 1);
+	EXPECT_EQ(g_num_suite_teardowns, 0);
+}
+
+TEST(suite_fixture_tests, setup_runs_once_before_second_test) {
+	g_num_tests_run++;
+	EXPECT_EQ(g_num_suite_setups, 1);
+	EXPECT_EQ(g_num_suite_teardowns, 0);
+}
+
+static int g_independent_value = 0;
+
+INDEPENDENT_SUITE_SETUP(independent_fixture_tests) {
+	g_independent_value = 42;
+}
+
+INDEPENDENT_SUITE_TEARDOWN(independent_fixture_tests) {
+	g_independent_value = 0;
+}
+
+TEST(independent_fixture_tests, setup_is_done_before_tests) {
+	EXPECT_EQ(g_independent_value, 42);
+}
+
+#ifdef RKTEST_FAILING_TESTS
+SUITE_SETUP(failing_suite_setup_tests) {
+	ASSERT_TRUE(false);
+}
+
+TEST(failing_suite_setup_tests, is_not_run) {
+	EXPECT_TRUE(true);
+}
+
+SUITE_SETUP(skipping_suite_setup_tests) {
+	RKTEST_SKIP("fixture is not available");
+}
+
+TEST(skipping_suite_setup_tests, is_not_run) {
+	EXPECT_TRUE(false);
+}
+
+SUITE_TEARDOWN(failing_suite_teardown_tests) {
+	EXPECT_EQ(1, 2);
+}
+
+TEST(failing_suite_teardown_tests, passes) {
+	EXPECT_TRUE(true);
+}
+
+#ifdef __linux__
+static bool g_overlapping_setup_started = false;
+
+static bool overlapping_setup_started(void) {
+	return __atomic_load_n(&g_overlapping_setup_started, __ATOMIC_ACQUIRE);
+}
+
+/* Only passes with --rktest_pipeline_fixtures=yes, where the setup of the next
+ * suite runs on a background thread while this test waits for it */
+TEST(pipelined_fixture_tests, next_suite_setup_overlaps) {
+	const struct timespec one_ms = { 0, 1000000 };
+	for (int i = 0; i < 500 && !overlapping_setup_started(); i++) {
+		nanosleep(&one_ms, NULL);
+	}
+	EXPECT_TRUE(overlapping_setup_started());
+}
+
+INDEPENDENT_SUITE_SETUP(overlapping_setup_tests) {
+	__atomic_store_n(&g_overlapping_setup_started, true, __ATOMIC_RELEASE);
+}
+
+TEST(overlapping_setup_tests, setup_is_done_before_tests) {
+	EXPECT_TRUE(overlapping_setup_started());
+}
+#endif
+#endif
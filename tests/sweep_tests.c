@@ -0,0 +1,60 @@
+#include <rktest/rktest.h>
+
+#include <math.h>
+#include <stdint.h>
+
+/* Rounds to nearest with ties away from zero, like roundf() */
+static float round_float(float x) {
+#ifndef RKTEST_FAILING_TESTS
+	const float truncated = truncf(x);
+	return fabsf(x - truncated) >= 0.5f ? truncated + copysignf(1.0f, x) : truncated;
+#else
+	/* x + 0.5f rounds up for 0.49999997f and for odd integers above 2^23 */
+	return x < 0.0f ? -floorf(-x + 0.5f) : floorf(x + 0.5f);
+#endif
+}
+
+static void check_round_float(const void* inputs, bool* failed, size_t count, void* user_data) {
+	(void)user_data;
+	const float* x = inputs;
+	for (size_t i = 0; i < count; i++) {
+		const float actual = round_float(x[i]);
+		const float expected = roundf(x[i]);
+		failed[i] = !isnan(x[i]) && actual != expected;
+	}
+}
+
+static void check_byte_swap(const void* inputs, bool* failed, size_t count, void* user_data) {
+	const uint16_t* x = inputs;
+	const uint16_t mask = *(const uint16_t*)user_data;
+	for (size_t i = 0; i < count; i++) {
+		const uint16_t swapped = (uint16_t)((x[i] << 8) | (x[i] >> 8));
+		const uint16_t swapped_back = (uint16_t)((swapped << 8) | (swapped >> 8));
+		failed[i] = (swapped_back & mask) != x[i];
+	}
+}
+
+TEST(sweep_tests, byte_swap_round_trips_for_all_uint16) {
+#ifndef RKTEST_FAILING_TESTS
+	const uint16_t mask = 0xffff;
+#else
+	const uint16_t mask = 0xfffe;
+#endif
+	EXPECT_FOR_ALL_UINT16(check_byte_swap, (void*)&mask);
+}
+
+TEST(sweep_tests, round_float_matches_roundf_around_one_half) {
+	/* Bit patterns of the floats in [0.498, 0.502) and (-0.502, -0.498] */
+	EXPECT_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0x3eff0000, 0x3f00ffff, check_round_float, NULL);
+	EXPECT_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0xbeff0000, 0xbf00ffff, check_round_float, NULL);
+}
+
+TEST(sweep_tests, round_float_matches_roundf_above_2_pow_23) {
+	/* Bit patterns of the floats in [2^23, 2^23 + 2^17), and of infinity and some nans */
+	EXPECT_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0x4b000000, 0x4b01ffff, check_round_float, NULL);
+	EXPECT_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 0x7f800000, 0x7f80ffff, check_round_float, NULL);
+}
+
+TEST(sweep_tests, empty_range_checks_nothing) {
+	ASSERT_FOR_RANGE(RKTEST_DOMAIN_FLOAT32, 1, 0, check_round_float, NULL);
+}
@@ -0,0 +1,30 @@
+#include <rktest/rktest.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef RKTEST_FAILING_TESTS
+#define EXPECTED_SUM 10
+#else
+#define EXPECTED_SUM 11
+#endif
+
+#define SUM_OF_SMALL_VALUES(T)             \
+	T values[] = { 1, 2, 3, 4 };           \
+	T sum = 0;                             \
+	for (size_t i = 0; i < 4; i++) {       \
+		sum += values[i];                  \
+	}                                      \
+	EXPECT_EQ((int)sum, EXPECTED_SUM);
+
+TYPED_TEST(typed_tests, sum_of_small_values, RKTEST_NUMERIC_TYPES, SUM_OF_SMALL_VALUES)
+
+typedef unsigned char uchar;
+#define UNSIGNED_TYPES(X, ...) X(uchar, __VA_ARGS__) X(uint32_t, __VA_ARGS__)
+
+#define WRAPS_AROUND_TO_ZERO(T) \
+	T max = (T)-1;              \
+	max += 1;                   \
+	EXPECT_EQ((int)max, 0);
+
+TYPED_TEST(typed_tests, wraps_around_to_zero, UNSIGNED_TYPES, WRAPS_AROUND_TO_ZERO)